@@ -9,12 +9,108 @@
 #include <libxml/encoding.h>
 #include <libxml/xmlwriter.h>
 #include <libxml/xmlschemastypes.h>
+#include <libxml/xmlreader.h>
 #include "LinkedListAPI.h"
 #include "GPXParser.h"
 #include "GPXHelpers.h"
 
 
 
+//Region allocator that owns every allocation of a GPXdoc built in arena mode.
+//Memory is bump-allocated from a few large blocks and is only released, all at once, by destroyArena
+typedef struct {
+    //lets the lists of the document allocate their nodes from the arena
+    ListAllocator allocator;
+    struct arenaBlock* blocks;
+    size_t nextBlockSize;
+    //the interned strings the document holds a reference to, see internArenaString
+    struct internTable* names;
+    //elements made outside the arena that the document took ownership of, see adoptArenaElement
+    struct arenaElement* elements;
+} GPXArena;
+
+GPXArena* createArena(void);
+
+//returns size bytes of zeroed memory, NULL if arena is NULL or out of memory
+void* arenaAllocate(GPXArena* arena, size_t size);
+
+void destroyArena(GPXArena* arena);
+
+//Creates an arena for another thread to allocate from while the parent is in use, stored in the parent.
+//It must be handed back with adoptChildArena, never destroyed on its own
+GPXArena* createChildArena(GPXArena* parent);
+
+//moves the memory of child into parent, which then frees it in destroyArena, and points lists allocated
+//from child at parent
+void adoptChildArena(GPXArena* parent, GPXArena* child);
+
+//Returns the pooled copy of text, shared by everyone who interns the same text, with one more reference
+//to it; NULL if out of memory.  Pooled strings must not be changed, and are given back with releaseString
+const char* internString(const char* text);
+
+//drops a reference taken by internString, freeing the pooled copy with its last reference.  Text that is
+//not from the pool is left alone
+void releaseString(const char* text);
+
+//Interns text for a document built in arena, which takes a single reference to each distinct string, found
+//without locking the pool, and releases them all in destroyArena.  Same as internString if arena is NULL
+const char* internArenaString(GPXArena* arena, const char* text);
+
+//releases the strings interned for arena; called by destroyArena
+void releaseArenaStrings(GPXArena* arena);
+
+//hands the strings interned for child over to parent; called by adoptChildArena
+void adoptArenaStrings(GPXArena* parent, GPXArena* child);
+
+//returns the arena the nodes of list come from, NULL if the list does not use an arena
+GPXArena* getListArena(List* list);
+
+//whether memory was allocated from one of the blocks of arena
+bool arenaContains(const GPXArena* arena, const void* memory);
+
+//Hands an element that was not allocated from arena, but was put in one of its lists, to arena, which
+//deletes it with deleteElement in destroyArena.  Returns false if out of memory
+bool adoptArenaElement(GPXArena* arena, void* element, void (*deleteElement)(void* data));
+
+//gives an element handed to arena back to its caller; returns false if arena did not have it
+bool releaseArenaElement(GPXArena* arena, void* element);
+
+//Per-thread state of the constructors below, set up by createGPXdocWithOptions for the duration of a parse
+typedef struct {
+    //arena that every allocation of the document comes from, NULL for ordinary malloc'd documents
+    GPXArena* arena;
+
+    //store track points in SegmentColumns instead of Waypoint structs
+    bool columnarSegments;
+
+    //threads readGPXTree may build elements on, 1 or less to build them on the calling thread only
+    int numThreads;
+
+    //schema the file must be valid against, NULL if it is not validated
+    xmlSchemaPtr schema;
+
+    //leave decoded point children out of otherData
+    bool typedPointData;
+
+    //storage of every list of the document
+    ListStorage listStorage;
+} GPXBuildContext;
+
+GPXBuildContext* getBuildContext(void);
+
+//calloc that allocates from the arena of the build context when there is one
+void* gpxCalloc(size_t count, size_t size);
+
+//initializeList that allocates from the arena of the build context when there is one, and sets the
+//appendData function of the list.  Lists in an arena do not delete their data, since the arena owns it
+List* gpxInitializeList(char* (*printFunction)(void* toBePrinted),void (*appendFunction)(StringBuilder* builder, void* toBeAppended),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
+
+//deletes a document that failed to build; documents in an arena are left for the owner of the arena to free
+void discardGPXdoc(GPXdoc* doc);
+
+//creates a GPXdoc with empty lists and the header fields of the <gpx> element, NULL if version or creator is missing
+GPXdoc* createEmptyGPXdoc(char* namespace, char* version, char* creator);
+
 GPXData* createGPXData(char* name, char* data);
 
 Waypoint* createWaypoint(char* name, double longitude, double latitude);
@@ -27,26 +123,211 @@ Track* createTrack(char* name);
 
 
 
+//number of processors online, at least 1
+int getProcessorCount(void);
+
+//Calls task(context, i, worker) for every i in [0, count) on up to numThreads threads, the calling thread
+//included, and returns once every call has returned.  numThreads <= 0 uses one thread per processor.
+//worker identifies the calling thread, from 0 to numThreads-1, and is 0 on the calling thread.
+//Indices are dealt out to the threads in contiguous ranges; a thread that runs out steals half of the
+//remaining range of another.  Returns false, without running anything, if out of memory
+bool runParallel(int numThreads, int count, void (*task)(void* context, int index, int worker), void* context);
+
+
+//The lists of a GPXdoc that the name index covers, in the order of its tables
+typedef enum {
+    NAME_WAYPOINT,
+    NAME_ROUTE,
+    NAME_TRACK
+} NameKind;
+
+//returns the first waypoint, route or track of doc with the given name, building the name index if needed
+void* lookupName(const GPXdoc* doc, NameKind kind, const char* name);
+
+void freeNameIndex(GPXdoc* doc);
+
+//frees the summary table of doc, see getGPXdocSummary
+void freeSummaries(GPXdoc* doc);
+
+//Add the segments and GPXData of a waypoint, route or track that was just inserted into, or removed from, one
+//of the lists of doc to its counts, or subtract them.  The counts must have been up to date before the change
+void addElementCounts(GPXdoc* doc, NameKind kind, const void* item);
+void removeElementCounts(GPXdoc* doc, NameKind kind, const void* item);
+
+//recounts doc if its waypoints, routes or tracks lists were changed other than through the functions above
+void updateGPXCounts(const GPXdoc* doc);
+
+//GPXData of the points of a segment, including the ones kept only as typed fields or in columns
+int countSegmentGPXData(const TrackSegment* segment);
+
 //function to open file using file name, read contents of file into char*, return char*
+//the contents are null-terminated; NULL if the file cannot be read
 char* fileOpener(char* filename);
 
 //function to copy one string to another, starting and ending at respective indexes
+//the copy comes from the arena of the build context when there is one
 char* stringCopy(char* string1, int startindex, int endindex);
 
 GPXData* makeGPXData(xmlNode* node);
 
+//The builders return NULL for a point with a missing, malformed or out of range coordinate, and for any
+//element containing one, so that one invalid <wpt>, <rtept> or <trkpt> fails the whole document.  Elements
+//with no text are not GPXData and are left out.
 Waypoint* makeWaypoint(xmlNode* node);
 
 Route* makeRoute(xmlNode* node);
 
 TrackSegment* makeTrackSegment(xmlNode* node);
 
+//allocates the struct and all four (zeroed) arrays of a SegmentColumns in one block, from arena if it is not NULL
+SegmentColumns* allocateColumns(int length, GPXArena* arena);
+
+//makes columns, from allocateColumns, the storage of the points of segment, which makes it columnar
+void setSegmentColumns(TrackSegment* segment, SegmentColumns* columns);
+
+//frees the columns of a segment that is not in an arena, whether they are its points or a cache
+void freeSegmentColumns(TrackSegment* segment);
+
+//the values a point would have in SegmentColumns: its <ele>, or NAN, and its <time>, or GPX_NO_TIME
+void getPointColumns(const Waypoint* w, double* elevation, int64_t* time);
+
+//the time getPointColumns gives a point, which the sorts and summaries use
+int64_t getPointTime(const Waypoint* w);
+
+//parseGPXDecimal for text that is not null terminated, such as SAX2 attribute values
+bool parseGPXDecimalLength(const char* text, size_t length, double* value);
+
+//Reads the lat and lon attributes of a point.  Returns false if either is missing or not a decimal number,
+//the same as if the point were out of range
+bool getCoordinates(xmlNode* node, double* latitude, double* longitude);
+
+//writes value as the shortest decimal text that reads back as the same double
+void formatGPXNumber(double value, char* buffer, size_t size);
+
+//number of typed fields in GPXPointFields
+#define GPX_NUM_POINT_FIELDS 5
+
+//Decodes the child of a point with the given name and text into fields, unless it is not one of the typed
+//children, fields already has it, or the text is invalid.  Returns the GPX_POINT_* flag decoded, or 0
+unsigned int decodePointField(GPXPointFields* fields, const char* name, const char* value);
+
+//fills in the fields of w from its otherData
+void decodePointData(Waypoint* w);
+
+//the position of a child of a point in the GPX 1.1 schema, counting <name>; unknown elements go last
+int getPointChildRank(const char* name);
+
+//A typed field written back out as text
+typedef struct {
+    const char* name;
+    int rank;
+    char value[40];
+} GPXFieldText;
+
+//the fields of w whose text is not in otherData, as text, ordered by rank; returns how many there are
+int getOmittedPointData(const Waypoint* w, GPXFieldText texts[GPX_NUM_POINT_FIELDS]);
+
+//reads the <trkpt> children of a <trkseg> into columns.  NULL if a point is invalid or out of memory
+SegmentColumns* makeSegmentColumns(xmlNode* node);
+
 Track* makeTrack(xmlNode* node);
 
+//builds the <wpt>, <rte> or <trk> element node and appends it to the matching list of doc, other elements are ignored
+//returns false if the element could not be built
+bool addGPXElement(GPXdoc* doc, xmlNode* node);
+
+//builds every <wpt>, <rte> and <trk> child of root on the threads of the build context, and appends them
+//to doc in document order, giving the same document as calling addGPXElement on each child in turn
+bool addGPXElementsParallel(GPXdoc* doc, xmlNode* root);
+
+//returns the compiled schema of schemaFile, compiling and caching it on first use; NULL if it cannot be compiled
+xmlSchemaPtr getCompiledSchema(const char* schemaFile);
+
+//validates doc against schema with the validation context of the calling thread
+bool validateXmlDoc(xmlDoc* doc, xmlSchemaPtr schema);
+
+//Bytes of a GPX file, wherever they came from, for the readers to parse in place.  The bytes may be
+//gzip or zstd compressed, in which case the readers decompress them as they go
+typedef struct {
+    //file name for messages and as the base URI, NULL for memory and file descriptors
+    const char* name;
+    const char* buffer;
+    size_t size;
+
+    //what closeInput releases: a mapping of the file, or a copy read from a descriptor that cannot be mapped
+    void* mapping;
+    size_t mappedSize;
+    char* copy;
+} GPXInput;
+
+//sets input to size bytes of buffer, which the caller keeps
+void openMemoryInput(const char* buffer, size_t size, GPXInput* input);
+
+//maps or reads everything left on fd, which stays open; returns false if it cannot be read
+bool openFdInput(int fd, GPXInput* input);
+
+//maps or reads the whole file; returns false if it cannot be opened or read
+bool openFileInput(const char* fileName, GPXInput* input);
+
+//releases what an open function set up; input is left empty
+void closeInput(GPXInput* input);
+
+//Compression of an input, told by its first bytes rather than by the file name
+typedef enum {
+    GPX_COMPRESSION_NONE,
+    GPX_COMPRESSION_GZIP,
+    GPX_COMPRESSION_ZSTD
+} GPXCompression;
+
+GPXCompression getInputCompression(const GPXInput* input);
+
+//Returns the read context of a compressed input, for libxml2 to read through readDecompressed and free
+//with closeDecompressed.  Large inputs are decompressed on a thread of their own, a few chunks ahead of
+//the parser.  NULL if the input is not compressed, or zstd input in a build without zstd
+void* openDecompressor(const GPXInput* input);
+
+//libxml2 read and close callbacks of a context from openDecompressor
+int readDecompressed(void* context, char* buffer, int length);
+int closeDecompressed(void* context);
+
+//reads what is left of a context from openDecompressor, and returns whether the input was complete and
+//valid.  libxml2 may take a read error after the root element is closed as the end of the input
+bool finishDecompressed(void* context);
+
+//parses the input into an XML tree, NULL if it is not well formed
+xmlDoc* readInputTree(const GPXInput* input);
+
+//returns a reader for the input, which the reader does not copy whole.  decompressor is set to the
+//decompressor of a compressed input, or NULL, which has to be passed to finishInput once the reader is freed
+xmlTextReaderPtr createInputReader(const GPXInput* input, void** decompressor);
+
+//returns a parser input buffer over the input, owned by whoever it is given to.  decompressor is set as
+//createInputReader sets it
+xmlParserInputBufferPtr createInputBuffer(const GPXInput* input, void** decompressor);
+
+//returns a parser context that reads the input through the same callbacks, for a SAX parse with
+//xmlParseDocument.  decompressor is set as createInputReader sets it
+xmlParserCtxtPtr createInputParserCtxt(const GPXInput* input, void** decompressor);
+
+//frees the decompressor of an input once the parser is done with it, and returns ok, or false if the rest
+//of the compressed input is not complete and valid.  Does nothing for a NULL decompressor
+bool finishInput(void* decompressor, bool ok);
+
+//validates the input against schema while it is read, without building a tree
+bool validateInput(const GPXInput* input, xmlSchemaPtr schema);
+
+//reads the input with xmlTextReader, one top-level element at a time; used by createGPXdocWithOptions
+GPXdoc* readGPXStream(const GPXInput* input);
+
+//returns the value of the attribute with the given name, NULL if the node does not have it
+char* getAttribute(xmlNode* node, char* name);
+
 char* getName(xmlNode* node);
 
 bool isName(xmlNode* node);
 
+bool isElement(xmlNode* node);
+
 bool isText(xmlNode* node);
 
 #endif
\ No newline at end of file
@@ -1,9 +1,15 @@
 #ifndef GPX_PARSER_H
 #define GPX_PARSER_H
 
+//The structs of this header are not binary compatible with the original assignment header.  GPXData.name is
+//a pointer instead of a char[256], which also moves value; Waypoint, TrackSegment and GPXdoc have gained fields
+//at their ends; and the List structs inside them have changed too, see LinkedListAPI.h.  Code built against
+//the original header, including an old libgpxparser.so, must be recompiled.  Route and Track are unchanged
+
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 #include <libxml/parser.h>
 #include <libxml/tree.h>
 #include <libxml/encoding.h>
@@ -21,13 +27,46 @@
 // e.g. comment, elevation, desciption, etc..
 typedef struct  {
     //GPXData name.  Must not be an empty string.
-	char 	name[256];
+    //Interned: every GPXData with the same name shares one copy, so names can be compared by pointer.
+    //It must not be changed or freed; create a new GPXData with createGPXData instead.  The name of a
+    //GPXData built by hand is not from the pool, and deleteGpxData leaves it to whoever allocated it
+	char* 	name;
 
     //GPXData value.  We use a C99 flexible array member, which we will discuss in class.
 	//Must not be an empty string
 	char	value[]; 
 } GPXData;
 
+//Flags of GPXPointFields, one for each typed field
+#define GPX_POINT_ELEVATION 0x1
+#define GPX_POINT_TIME 0x2
+#define GPX_POINT_HDOP 0x4
+#define GPX_POINT_SATELLITES 0x8
+#define GPX_POINT_SPEED 0x10
+
+//The <ele>, <time>, <hdop>, <sat> and <speed> children of a point, decoded once when the point is read.
+//Children whose text is not a valid number or date-time are not decoded, and stay in otherData as text.
+//The fields are not updated when otherData is changed afterwards; call refreshPointFields after changing it.
+//Until then the fields win over the text wherever both could be read: getSegmentColumns, the binary cache,
+//compareWaypointsByTime, getNumGPXData and the summaries all read a decoded field rather than its GPXData.
+//A zeroed struct has no fields, and then the text of the point is decoded where it is needed
+typedef struct {
+    //GPX_POINT_* flags of the fields below that hold a value
+    unsigned char present;
+
+    //GPX_POINT_* flags of the fields whose GPXData was left out of otherData, see GPXParseOptions.typedPointData
+    unsigned char textOmitted;
+
+    int satellites;
+    double elevation;
+
+    //nanoseconds since the Unix epoch (UTC), as parseGPXTime returns it
+    int64_t time;
+
+    double hdop;
+    double speed;
+} GPXPointFields;
+
 typedef struct {
     //Waypoint name.  Must not be NULL.  May be an empty string.
     char* name;
@@ -44,8 +83,30 @@ typedef struct {
     //the name already has its own dedicated filed in the Waypoint sruct - so do not place the name in this list
     //All objects in the list will be of type GPXData.  It must not be NULL.  It may be empty.
     List* otherData;
+
+    //Typed copies of the common children of the point, filled in by the parser
+    GPXPointFields fields;
 } Waypoint;
 
+//Summary of a set of points, see getGPXdocSummary
+typedef struct {
+    int numPoints;
+
+    //Bounding box of the points in degrees, NAN if there are none
+    double minLatitude;
+    double minLongitude;
+    double maxLatitude;
+    double maxLongitude;
+
+    //Length in metres, as getRouteLen and getTrackLen compute it.  For a document, the sum of the lengths
+    //of its routes and tracks
+    double length;
+
+    //Earliest and latest <time> of the points, GPX_NO_TIME if none of them has one
+    int64_t firstTime;
+    int64_t lastTime;
+} GPXSummary;
+
 typedef struct {
     //Route name.  Must not be NULL.  May be an empty string.
     char* name;
@@ -62,10 +123,43 @@ typedef struct {
     List* otherData;
 } Route;
 
+//Value of SegmentColumns.time for points without a <time>
+#define GPX_NO_TIME INT64_MIN
+
+//Columnar copy of the points of a track segment: one dense array per coordinate, indexed by point.
+//The struct and its arrays are a single allocation.
+typedef struct {
+    //Number of points, i.e. the length of every array below
+    int length;
+
+    double* latitude;
+    double* longitude;
+
+    //<ele> of every point, NAN for points without one.  NULL if no point of the segment has an <ele>
+    double* elevation;
+
+    //<time> of every point in nanoseconds since the Unix epoch (UTC), GPX_NO_TIME for points without one.
+    //NULL if no point of the segment has a <time>
+    int64_t* time;
+} SegmentColumns;
+
 typedef struct {
     //Waypoints that make up the track segment
     //All objects in the list will be of type Waypoint.  It must not be NULL.  It may be empty.
+    //Empty for segments read with GPXParseOptions.columnarSegments, whose points are only in columns
     List* waypoints;
+
+    //Columnar copy of the points, owned by the segment: the storage of the points for segments read with
+    //GPXParseOptions.columnarSegments, or a cache of the waypoints list.  Managed by the library, and only
+    //meaningful once columnsTag says so: read it through getSegmentColumns and isColumnarSegment
+    SegmentColumns* columns;
+
+    //Set by the library together with columns, from its address and what it holds, so that a segment the caller
+    //made, whose fields past waypoints may be garbage, reads as having no columns
+    uintptr_t columnsTag;
+
+    //Version of the waypoints list the cached columns were built from.  Managed by getSegmentColumns
+    unsigned long columnsVersion;
 } TrackSegment;
 
 typedef struct {
@@ -108,6 +202,21 @@ typedef struct {
     //Tracks in the GPX file
     //All objects in the list will be of type Track.  It must not be NULL.  It may be empty.
     List* tracks;
+
+    //Lookup table behind getWaypoint, getRoute and getTrack.  NULL until the first lookup.
+    //Managed by the library; see invalidateNameIndex
+    struct gpxNameIndex* nameIndex;
+
+    //What getNumSegments and getNumGPXData return, counted while the document is built and kept up to
+    //date by the functions that add elements to and remove them from it.  Managed by the library; see recountGPXdoc
+    int numSegments;
+    int numGPXData;
+    //Sum of the versions of the waypoints, routes and tracks lists the counts were last brought up to date with
+    unsigned long countsVersion;
+
+    //Summaries of the document and of its routes and tracks.  NULL until the first summary.
+    //Managed by the library; see invalidateGPXdocSummary
+    struct gpxSummaryTable* summaries;
 } GPXdoc;
 
 
@@ -136,6 +245,9 @@ GPXdoc* createGPXdoc(char* fileName);
 **/
 char* GPXdocToString(GPXdoc* doc);
 
+//Appends the string GPXdocToString returns to builder, growing it once per doubling rather than once per element
+void appendGPXdoc(StringBuilder* builder, const GPXdoc* doc);
+
 /** Function to delete doc content and free all the memory.
  *@pre GPX object exists, is not null, and has not been freed
  *@post GPX object had been freed
@@ -166,9 +278,20 @@ int getNumTracks(const GPXdoc* doc);
 //Total number of segments in all tracks in the document
 int getNumSegments(const GPXdoc* doc);
 
-//Total number of GPXData elements in the document
+//Total number of GPXData elements in the document, counting the <ele>, <time> and other children of points
+//that are kept as typed fields or in columns rather than as GPXData
 int getNumGPXData(const GPXdoc* doc);
 
+//The five functions above take O(1).  The last two return counts kept in the document, which the add and
+//remove functions below keep up to date.  The counts are taken again from scratch, by the next call, once the
+//waypoints, routes or tracks lists of the document have been changed directly through the list API, which
+//getListVersion tells them about.  They are not updated when a list inside an element, such as the segments of
+//a track or the otherData of a point, is changed directly; call this function after doing so
+void recountGPXdoc(GPXdoc* doc);
+
+//Counts the segments and GPXData of doc from scratch, and returns whether they match the counts it keeps
+bool verifyGPXCounts(const GPXdoc* doc);
+
 // Function that returns a waypoint with the given name.  If more than one exists, return the first one.  
 // Return NULL if the waypoint does not exist
 Waypoint* getWaypoint(const GPXdoc* doc, char* name);
@@ -179,28 +302,603 @@ Track* getTrack(const GPXdoc* doc, char* name);
 // Return NULL if the route does not exist
 Route* getRoute(const GPXdoc* doc, char* name);
 
+//The three functions above use a hash table of the names in the document, built on the first lookup.
+//The table is rebuilt by itself once the waypoints, routes or tracks lists have been changed through the list
+//API, which getListVersion tells it about, but not when an existing name is changed or the data of a Node is
+//replaced directly; call this function after doing so.
+//Building the table writes to the document, so the lookups are not thread-safe: threads that share a document
+//must not call them at the same time, or must call each of them once before sharing it
+void invalidateNameIndex(GPXdoc* doc);
+
+//Decodes the fields of wpt again from its otherData, after GPXData have been added to, removed from or changed
+//in it.  Fields whose text was left out of otherData by GPXParseOptions.typedPointData have no text to be
+//decoded from, and are kept.  Summaries and columns already built from the point still need to be invalidated
+void refreshPointFields(Waypoint* wpt);
+
+//Functions that append a waypoint, route or track to the document, which takes ownership of it.  A
+//GPXParseOptions.useArena document keeps track of the elements the caller made and deletes them when it is
+//deleted, as it does with its own; if it runs out of memory for that, the element is not added
+void addWaypoint(GPXdoc* doc, Waypoint* wpt);
+void addRoute(GPXdoc* doc, Route* rt);
+void addTrack(GPXdoc* doc, Track* tr);
+
+//Functions that take a waypoint, route or track out of the document and give it back to the caller, who then
+//owns it; anything the parser of a GPXParseOptions.useArena document allocated stays valid until the document
+//is deleted instead, and must not be freed.  They find the element by its address, and return false if it is
+//not in the document
+bool removeWaypoint(GPXdoc* doc, Waypoint* wpt);
+bool removeRoute(GPXdoc* doc, Route* rt);
+bool removeTrack(GPXdoc* doc, Track* tr);
+
+//Functions that append a segment to a track of the document, or take one out of it, as above
+void addTrackSegment(GPXdoc* doc, Track* tr, TrackSegment* seg);
+bool removeTrackSegment(GPXdoc* doc, Track* tr, TrackSegment* seg);
+
+//Functions that append a GPXData to the otherData list of a waypoint, route, track or point of the document,
+//or take one out of it, as above.  The typed fields of a point are not changed; see refreshPointFields
+void addGPXData(GPXdoc* doc, List* otherData, GPXData* data);
+bool removeGPXData(GPXdoc* doc, List* otherData, GPXData* data);
+
+
+/* Public API - streaming */
+
+/** Function to create an GPX object based on the contents of an GPX file, without ever holding the
+ * whole XML tree of the file in memory.  Each top-level <wpt>, <rte> and <trk> element is read on its own,
+ * converted, and released before the next one is read, so peak memory depends on the largest element
+ * rather than on the size of the file.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+**/
+GPXdoc* createGPXdocStreaming(char* fileName);
+
+
+/* Public API - parse options */
+
+//Options for createGPXdocWithOptions.  A zeroed struct gives the behaviour of createGPXdoc
+typedef struct {
+    //Read the file one top-level element at a time, like createGPXdocStreaming
+    bool streaming;
+
+    //Allocate the document and everything reachable from it out of a few large blocks, which deleteGPXdoc
+    //releases all at once instead of freeing every struct, list and node separately.
+    //The lists of such a document own neither their nodes nor their data: data removed from them stays
+    //valid until the document is deleted, and must not be freed by the caller.
+    bool useArena;
+
+    //Store the points of every track segment only as SegmentColumns: latitude, longitude, <ele> and <time>
+    //are kept, while the Waypoint structs, point names and other point data are never created.
+    //The waypoints list of each segment stays empty.
+    bool columnarSegments;
+
+    //Build the <wpt>, <rte> and <trk> elements, and the <trkseg> elements of every track, on this many
+    //threads once the file has been read.  The document is the same as the one built on a single thread.
+    //0 or 1 uses the calling thread only, a negative number one thread per processor.
+    //Ignored when streaming, which reads and builds one element at a time.
+    int numThreads;
+
+    //Name of an XSD file the GPX file must be valid against, NULL to skip validation.  The schema is compiled
+    //on first use and cached for the life of the process.  A streamed file is validated in a first pass over
+    //the file, so memory stays bounded; otherwise the tree that was read is validated before it is converted
+    const char* schemaFile;
+
+    //Keep the point children decoded into Waypoint.fields only as typed values, instead of also as GPXData
+    //text in otherData, which saves two allocations for every point with an <ele> and a <time>.
+    //GPXdocToString, writeGPXdoc and saveGPXBinary write such fields from their values, so <ele>300.50</ele>
+    //comes back as <ele>300.5</ele>
+    bool typedPointData;
+
+    //Store the elements of every list of the document in chunks of pointers (LIST_UNROLLED) instead of a
+    //Node each, which makes building and iterating large segments several times faster
+    bool unrolledLists;
+} GPXParseOptions;
+
+/** Function to create an GPX object based on the contents of an GPX file, with control over how it is read
+ * and where its memory comes from.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+ *@param options - how to build the document.  NULL gives the same result as createGPXdoc
+**/
+GPXdoc* createGPXdocWithOptions(char* fileName, const GPXParseOptions* options);
+
+
+/* Public API - memory and file descriptor input */
+
+//Every function that reads a GPX file, from a name, memory or a file descriptor, also reads gzip and zstd
+//compressed GPX, told apart by their first bytes.  The text is decompressed as it is parsed, never in
+//full, and on a thread of its own for larger inputs.  zstd needs a build where the Makefile found zstd.h
+
+/** Function to create an GPX object from GPX text that is already in memory, such as a network payload
+ * or an embedded resource.  The text does not need to be null-terminated, and is handed to the parser
+ * a few kilobytes at a time rather than being copied whole first.
+ *@pre buffer is not NULL and holds size bytes
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned.
+		The buffer is not modified, and may be freed once the function returns
+ *@return the pinter to the new struct or NULL
+ *@param buffer - the GPX text
+ *@param size - the number of bytes in buffer
+**/
+GPXdoc* createGPXdocFromMemory(const char* buffer, size_t size);
+
+/** Same as createGPXdocFromMemory, with options as for createGPXdocWithOptions
+ *@param options - how to build the document.  NULL gives the same result as createGPXdocFromMemory
+**/
+GPXdoc* createGPXdocFromMemoryWithOptions(const char* buffer, size_t size, const GPXParseOptions* options);
+
+/** Function to create an GPX object from everything left to read on a file descriptor.
+ * A regular file is mapped into memory from the current offset and parsed from the mapping, without
+ * being read into a buffer first; pipes, sockets and other descriptors that cannot be mapped are read to the end first.
+ *@pre fd is open for reading
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, and NULL was returned.
+		fd is left open for the caller to close, and its offset is unspecified
+ *@return the pinter to the new struct or NULL
+ *@param fd - the file descriptor to read
+**/
+GPXdoc* createGPXdocFromFd(int fd);
+
+/** Same as createGPXdocFromFd, with options as for createGPXdocWithOptions
+ *@param options - how to build the document.  NULL gives the same result as createGPXdocFromFd
+**/
+GPXdoc* createGPXdocFromFdWithOptions(int fd, const GPXParseOptions* options);
+
+
+/* Public API - validation */
+
+/** Function to create a GPX object from a GPX file that is valid against an XSD schema.
+ * Same as createGPXdocWithOptions with only GPXParseOptions.schemaFile set.
+ *@pre File name cannot be an empty string or NULL.
+       File represented by this name must exist and must be readable.
+       Schema file name is not NULL or an empty string, and names a valid XSD file
+ *@post Either:
+        A valid GPXdoc has been created and its address was returned
+		or 
+		An error occurred, or the file is not valid, and NULL was returned
+ *@return the pinter to the new struct or NULL
+ *@param fileName - a string containing the name of the GPX file
+ *@param gpxSchemaFile - a string containing the name of the XSD file
+**/
+GPXdoc* createValidGPXdoc(char* fileName, char* gpxSchemaFile);
+
+/** Function to check a GPX file against an XSD schema without creating a GPX object.
+ * The file is validated while it is read, without building a tree.  The schema is parsed and compiled
+ * only on the first call for a given file name, and is then shared by every thread; each thread
+ * validates with a validation context of its own.
+ *@return true if the file is valid against the schema, false if it is not, or either file cannot be read
+ *@param fileName - a string containing the name of the GPX file
+ *@param gpxSchemaFile - a string containing the name of the XSD file
+**/
+bool validateGPXFile(const char* fileName, const char* gpxSchemaFile);
+
+
+/* Public API - batch */
+
+//Why a file of a batch produced no document
+typedef enum {
+    GPX_BATCH_OK,
+    //the file name is NULL or empty, or the file cannot be opened for reading
+    GPX_BATCH_FILE_ERROR,
+    //the file is not a well-formed GPX file, or memory ran out while building it
+    GPX_BATCH_PARSE_ERROR
+} GPXBatchError;
+
+//The outcome for one file of a batch.  doc is NULL unless error is GPX_BATCH_OK
+typedef struct {
+    GPXdoc* doc;
+    GPXBatchError error;
+} GPXBatchResult;
+
+/** Function to create a GPX object from each of a list of files, using several threads.
+ * Files are dealt out to the threads in contiguous runs; a thread that finishes its run takes over half
+ * of the remaining files of another, so a few large files do not leave the other threads idle.
+ *@pre fileNames holds numFiles file names
+ *@post Either:
+        An array of numFiles results, in the order of fileNames, was returned
+		or 
+		An error occurred, and NULL was returned
+ *@return the results, to be freed with deleteGPXBatch, or NULL if out of memory
+ *@param fileNames - the names of the GPX files
+ *@param numFiles - the number of files
+ *@param numThreads - the number of threads to use; 0 or less uses one per processor
+ *@param options - how to build every document, as for createGPXdocWithOptions.  May be NULL
+**/
+GPXBatchResult* createGPXdocBatch(char** fileNames, int numFiles, int numThreads, const GPXParseOptions* options);
+
+//Deletes every document of a batch and the array of results.  Documents the caller wants to keep
+//must have their entry set to NULL first
+void deleteGPXBatch(GPXBatchResult* results, int numFiles);
+
+
+/* Public API - columnar track segments */
+
+/** Function that returns the points of a track segment as dense arrays.
+ * For segments read with GPXParseOptions.columnarSegments this is the storage of the points.
+ * For other segments the columns are built from the waypoints list on the first call, and rebuilt
+ * once the list has been changed through the list API.  Points changed in place are not noticed;
+ * call invalidateSegmentColumns after changing one.
+ * A rebuild reuses the memory of the previous columns when they have room for the points.
+ *@pre segment is not NULL
+ *@post segment->columns is set
+ *@return the columns of the segment, or NULL if they could not be allocated
+ *@param segment - the track segment
+**/
+SegmentColumns* getSegmentColumns(TrackSegment* segment);
+
+//Drops the columns cached by getSegmentColumns, so the next call builds them again.  Does nothing to a
+//columnar segment, whose columns are its points
+void invalidateSegmentColumns(TrackSegment* segment);
+
+//Whether the points of segment are stored only in its columns, rather than in its waypoints list
+bool isColumnarSegment(const TrackSegment* segment);
+
+//Number of points of segment, wherever they are stored
+int getSegmentNumPoints(const TrackSegment* segment);
+
+/** Function that parses an ISO 8601 date-time, as used by GPX <time> elements, e.g. 2020-05-01T13:45:10.5Z
+ *@return true if text is a valid date-time, false otherwise
+ *@param text - the date-time
+ *@param nanoseconds - receives the time in nanoseconds since the Unix epoch (UTC)
+**/
+bool parseGPXTime(const char* text, int64_t* nanoseconds);
+
+/** Function that parses an xsd:decimal, as used by the lat and lon attributes and by <ele>, e.g. -80.4999305.
+ * Whitespace around the number is allowed; exponents, and anything else, are not.  Unlike atof and strtod
+ * the result does not depend on the locale, and text that is not a number is reported as an error.
+ * Numbers of up to 15 significant digits take a fast path that is exact; longer ones, of any length, are read
+ * by strtod in the "C" locale
+ *@return true if text is a decimal number, false otherwise, in which case value is unchanged
+ *@param text - the number
+ *@param value - receives the value, rounded to the nearest double
+**/
+bool parseGPXDecimal(const char* text, double* value);
+
+/** Function that formats a time as an ISO 8601 date-time in UTC, e.g. 2020-05-01T13:45:10.5Z.
+ * The fraction of a second is only written if it is not 0, with as many digits as it needs.
+ *@return false if buffer is too small, or the year is outside 0-9999
+ *@param nanoseconds - the time in nanoseconds since the Unix epoch
+ *@param buffer - receives the date-time; 31 characters are always enough
+ *@param size - the size of buffer
+**/
+bool formatGPXTime(int64_t nanoseconds, char* buffer, size_t size);
+
+
+/* Public API - distances */
+
+//All distances are great-circle (haversine) distances in metres, on a sphere of radius 6371 km.
+//Coordinates are in degrees.
+
+//Distance between two points, computed with the C math library
+double haversineDistance(double lat1, double lon1, double lat2, double lon2);
+
+/** Function that computes the length of every leg of a path given as dense coordinate arrays.
+ * The work is vectorised, using AVX2 or SSE2 as chosen for the CPU at load time where available.
+ *@pre distances has room for length-1 values
+ *@post distances[i] is the distance from point i to point i+1
+ *@param latitudes - latitude of every point
+ *@param longitudes - longitude of every point
+ *@param length - the number of points
+ *@param distances - receives the length-1 leg distances
+**/
+void getLegDistances(const double* latitudes, const double* longitudes, int length, double* distances);
+
+//Sum of the leg distances of a path, 0 if it has fewer than two points
+double getPathLength(const double* latitudes, const double* longitudes, int length);
+
+//Length of a route: the sum of the distances between its consecutive waypoints
+float getRouteLen(const Route* rt);
+
+//Length of a track: the sum of the distances between its consecutive points, including the distance
+//from the last point of each segment to the first point of the next one
+float getTrackLen(const Track* tr);
+
+
+/* Public API - summaries */
+
+//Functions that return the point count, bounding box, length and time span of a document, route or track.
+//Each summary is computed on the first call and kept in a table owned by the document, keyed by the element
+//it describes, so later calls take O(1).  The summary of a document is made of the summaries of its routes and
+//tracks and of its own waypoints, so after a change only the part that was touched is walked again.  Columnar
+//segments are read from their columns.  A summary stays valid until the element it describes is changed or
+//removed from the document, or the document is deleted.  The functions return NULL if an argument is NULL or
+//memory runs out.  Computing a summary writes to the table, so the functions are not thread-safe: threads
+//that share a document must not call them at the same time, or must call getGPXdocSummary once before sharing it
+const GPXSummary* getGPXdocSummary(const GPXdoc* doc);
+const GPXSummary* getRouteSummary(const GPXdoc* doc, const Route* rt);
+const GPXSummary* getTrackSummary(const GPXdoc* doc, const Track* tr);
+
+//The functions that add elements to a document and remove them keep the summaries up to date, and so do
+//direct changes to the waypoints, routes and tracks lists of a document, which are noticed through the versions
+//of the lists.  After changing a route or track in any other way, call invalidateRouteSummary or
+//invalidateTrackSummary with the document it is in, and invalidateGPXdocSummary after changing the waypoints of
+//the document in place
+void invalidateGPXdocSummary(GPXdoc* doc);
+void invalidateRouteSummary(GPXdoc* doc, Route* rt);
+void invalidateTrackSummary(GPXdoc* doc, Track* tr);
+
+
+/* Public API - visitor */
+
+//The kind of point passed to the onWaypoint callback of a GPXVisitor
+typedef enum {
+    GPX_WAYPOINT,
+    GPX_ROUTE_POINT,
+    GPX_TRACK_POINT
+} GPXPointKind;
+
+//A borrowed view of a GPXData element.  The strings belong to the visitor and are only valid
+//until the callback that received them returns
+typedef struct {
+    const char* name;
+    const char* value;
+} GPXDataView;
+
+//A borrowed view of a <wpt>, <rtept> or <trkpt>.  Like GPXDataView, it is only valid during the callback
+typedef struct {
+    GPXPointKind kind;
+
+    //Point name.  Never NULL.  Empty if the point has no <name> child.
+    const char* name;
+
+    double longitude;
+    double latitude;
+
+    //Children of the point other than <name>, in document order
+    const GPXDataView* otherData;
+    int numData;
+} WaypointView;
+
+//A borrowed view of a <rte> or <trk>.  Only the <name> and other data elements that appear before the
+//first <rtept>/<trkseg> are included, since the begin callback is issued when the first of those is reached
+typedef struct {
+    const char* name;
+    const GPXDataView* otherData;
+    int numData;
+} GPXElementView;
+
+//Callbacks issued while a GPX file is read.  Any callback may be NULL.
+//A callback that returns false stops the parse, and visitGPXFile returns false.
+typedef struct {
+    void* userData;
+    bool (*onWaypoint)(const WaypointView* point, void* userData);
+    bool (*onRouteBegin)(const GPXElementView* route, void* userData);
+    bool (*onRouteEnd)(void* userData);
+    bool (*onTrackBegin)(const GPXElementView* track, void* userData);
+    bool (*onTrackEnd)(void* userData);
+    bool (*onSegmentBegin)(void* userData);
+    bool (*onSegmentEnd)(void* userData);
+} GPXVisitor;
+
+/** Function to read a GPX file and report its points, routes, tracks and segments to a set of callbacks,
+ * in document order, without building a GPXdoc.  The strings handed to the callbacks are stored in buffers
+ * that are reused from one point to the next, so no memory is allocated per point once they have grown
+ * to the size of the largest point.
+ *@pre File name cannot be an empty string or NULL.  visitor is not NULL.
+ *@post the callbacks have been called for every element of the file, or until one of them returned false
+ *@return true if the whole file was read, false if it could not be parsed or a callback stopped the parse
+ *@param fileName - a string containing the name of the GPX file
+ *@param visitor - the callbacks to issue
+**/
+bool visitGPXFile(char* fileName, const GPXVisitor* visitor);
+
+/** Same as visitGPXFile, for GPX text that is already in memory, as createGPXdocFromMemory reads it
+ *@pre buffer is not NULL and holds size bytes.  visitor is not NULL.
+ *@param buffer - the GPX text, which may be compressed as a file may
+ *@param size - the number of bytes in buffer
+ *@param visitor - the callbacks to issue
+**/
+bool visitGPXFromMemory(const char* buffer, size_t size, const GPXVisitor* visitor);
+
+/** Same as visitGPXFile, for everything left to read on a file descriptor, as createGPXdocFromFd reads it.
+ * fd is left open for the caller to close, and its offset is unspecified
+ *@pre fd is open for reading.  visitor is not NULL.
+ *@param fd - the file descriptor to read
+ *@param visitor - the callbacks to issue
+**/
+bool visitGPXFromFd(int fd, const GPXVisitor* visitor);
+
+
+
+/* Public API - writer */
+
+/** Function to write a document as a GPX 1.1 file.  Elements are streamed out through xmlTextWriter as the
+ * document is walked, so no XML tree is built and memory use does not depend on the size of the document.
+ * The namespace, version, creator and every GPXData of the document are written; <name> is placed where
+ * the GPX 1.1 schema expects it, and left out for elements whose name is empty.
+ *@pre doc is not NULL and is valid
+ *@post the file has been written.  It is written to a temporary file in the same directory first, which
+ *      replaces fileName once it is complete, so a write that fails leaves fileName as it was
+ *@return true on success, false otherwise
+ *@param doc - the document to write
+ *@param fileName - the file to write
+**/
+bool writeGPXdoc(const GPXdoc* doc, const char* fileName);
+
+//Same as writeGPXdoc, writing to an open file descriptor, which is left open
+bool writeGPXdocToFd(const GPXdoc* doc, int fd);
+
+
+/* Public API - spatial index */
+
+//A point found by a spatial query, with the elements it belongs to
+typedef struct {
+    GPXPointKind kind;
+
+    //The point.  NULL for points of columnar track segments, which only exist in segment->columns
+    Waypoint* waypoint;
+
+    //The route of a GPX_ROUTE_POINT, or the track and segment of a GPX_TRACK_POINT.  NULL otherwise
+    Route* route;
+    Track* track;
+    TrackSegment* segment;
+
+    //Position of the point in its waypoints list, or in the columns of its segment
+    int index;
+
+    double latitude;
+    double longitude;
+} GPXSpatialHit;
+
+//A read-only R-tree over every waypoint, route point and track point of a document
+typedef struct gpxSpatialIndex GPXSpatialIndex;
+
+/** Function that indexes the points of a document for box and radius queries.  The tree is bulk-loaded
+ * (Sort-Tile-Recursive) in O(n log n), and holds pointers into the document: it must be rebuilt after the
+ * document is changed, and deleted before the document is.
+ *@pre doc is not NULL
+ *@return the index, or NULL if it could not be allocated
+ *@param doc - the document to index
+**/
+GPXSpatialIndex* buildSpatialIndex(const GPXdoc* doc);
+
+void deleteSpatialIndex(GPXSpatialIndex* index);
+
+//Number of points in the index
+int getSpatialIndexSize(const GPXSpatialIndex* index);
+
+/** Function that reports every indexed point inside a latitude/longitude box, edges included.
+ * If minLon is greater than maxLon the box is taken to cross the antimeridian.
+ *@return the number of points reported
+ *@param visit - called for every point found, in no particular order.  Returning false stops the query.
+                 May be NULL, to only count the points
+ *@param userData - passed to visit
+**/
+int querySpatialBox(const GPXSpatialIndex* index, double minLat, double minLon, double maxLat, double maxLon,
+                    bool (*visit)(const GPXSpatialHit* hit, void* userData), void* userData);
+
+//Same as querySpatialBox, for the points within metres of (latitude, longitude) by haversineDistance
+int querySpatialRadius(const GPXSpatialIndex* index, double latitude, double longitude, double metres,
+                       bool (*visit)(const GPXSpatialHit* hit, void* userData), void* userData);
+
+
+/* Public API - binary cache */
+
+//A document saved with saveGPXBinary and mapped into memory with mapGPXBinary.  Everything read from it
+//points straight into the mapping, and stays valid until unmapGPXBinary
+typedef struct gpxBinary GPXBinary;
+
+//The points of the document's waypoints, a route, or a track segment, as arrays into the mapping
+typedef struct {
+    int length;
+    const double* latitude;
+    const double* longitude;
+
+    //NAN for points without an <ele>
+    const double* elevation;
+
+    //Nanoseconds since the Unix epoch (UTC), GPX_NO_TIME for points without a <time>
+    const int64_t* time;
+
+    //Index of the first point in the file, for getBinaryName and getBinaryData with GPX_BINARY_POINT
+    int firstPoint;
+} GPXBinaryPoints;
+
+//The kinds of element whose name and GPXData can be read from a GPXBinary
+typedef enum {
+    GPX_BINARY_POINT,
+    GPX_BINARY_ROUTE,
+    GPX_BINARY_TRACK
+} GPXBinaryElement;
+
+/** Function to save a document as a flat binary file that mapGPXBinary can load without parsing.
+ * The file is little-endian and versioned, and carries checksums of its header and its contents.
+ * Only little-endian machines can read and write it.
+ *@pre doc is not NULL
+ *@post the file has been written.  It is written to a temporary file in the same directory first, which
+ *      replaces fileName once it is complete, so a write that fails leaves fileName as it was
+ *@return true on success, false if the file could not be written or the document is too large for the format
+ *@param doc - the document to save
+ *@param fileName - the file to write
+**/
+bool saveGPXBinary(const GPXdoc* doc, const char* fileName);
+
+/** Function to map a file written by saveGPXBinary into memory.  Only the header is read and checked,
+ * so the cost of opening the file does not depend on its size: the rest is paged in as it is used.
+ * Call verifyGPXBinary to check the contents against their checksum as well.
+ *@return the mapped file, or NULL if it cannot be opened or is not a valid file of this format and version
+ *@param fileName - the file to map
+**/
+GPXBinary* mapGPXBinary(const char* fileName);
+
+//Reads the whole file and compares it with the checksum saved in its header
+bool verifyGPXBinary(const GPXBinary* binary);
+
+void unmapGPXBinary(GPXBinary* binary);
+
+//Builds a regular GPXdoc with the same contents as the file, NULL if out of memory or the file is corrupt
+GPXdoc* gpxBinaryToGPXdoc(const GPXBinary* binary);
+
+double getBinaryVersion(const GPXBinary* binary);
+const char* getBinaryCreator(const GPXBinary* binary);
+const char* getBinaryNamespace(const GPXBinary* binary);
+
+int getBinaryNumRoutes(const GPXBinary* binary);
+int getBinaryNumTracks(const GPXBinary* binary);
+int getBinaryNumSegments(const GPXBinary* binary, int track);
+
+//Points of the document's waypoints, of a route, and of a segment of a track.  Indices out of range give no points
+GPXBinaryPoints getBinaryWaypoints(const GPXBinary* binary);
+GPXBinaryPoints getBinaryRoutePoints(const GPXBinary* binary, int route);
+GPXBinaryPoints getBinarySegmentPoints(const GPXBinary* binary, int track, int segment);
+
+//Name of a point, route or track, NULL if index is out of range.  Points of columnar segments have empty names
+const char* getBinaryName(const GPXBinary* binary, GPXBinaryElement kind, int index);
+
+//GPXData of a point, route or track, in document order.  The view's strings are NULL if data is out of range
+int getBinaryNumData(const GPXBinary* binary, GPXBinaryElement kind, int index);
+GPXDataView getBinaryData(const GPXBinary* binary, GPXBinaryElement kind, int index, int data);
 
 /* ******************************* List helper functions  - MUST be implemented *************************** */
 
+//The append* functions add the same text the matching *ToString function returns to a StringBuilder,
+//without allocating a string of their own.  The lists of a GPXdoc use them through appendListToString.
+
 void deleteGpxData( void* data);
 char* gpxDataToString( void* data);
+void appendGpxData(StringBuilder* builder, void* data);
 int compareGpxData(const void *first, const void *second);
 
 void deleteWaypoint(void* data);
 char* waypointToString( void* data);
+void appendWaypoint(StringBuilder* builder, void* data);
 int compareWaypoints(const void *first, const void *second);
 
 void deleteRoute(void* data);
 char* routeToString(void* data);
+void appendRoute(StringBuilder* builder, void* data);
 int compareRoutes(const void *first, const void *second);
 
 void deleteTrackSegment(void* data);
 char* trackSegmentToString(void* data);
+void appendTrackSegment(StringBuilder* builder, void* data);
 int compareTrackSegments(const void *first, const void *second);
 
 void deleteTrack(void* data);
 char* trackToString(void* data);
+void appendTrack(StringBuilder* builder, void* data);
 int compareTracks(const void *first, const void *second);
 
+//The compare functions order GPXData by name, then value; waypoints by name, then latitude, then longitude;
+//routes and tracks by name, then their number of waypoints or segments; and track segments by the time of
+//their first point, then their number of points.  Anything without a time goes after everything with one.
+
+//Orders waypoints by their <time>, for sorting the points of a segment or route with sortList
+int compareWaypointsByTime(const void *first, const void *second);
+
 
 #endif
\ No newline at end of file
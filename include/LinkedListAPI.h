@@ -3,6 +3,12 @@
  * @author CIS*2750 S18 (based on the ListADT from CIS*2520, S17)
  * @date May 2018
  * @brief File containing the function definitions of a doubly linked list
+ *
+ * The List and ListIterator structs have gained fields since the original CIS*2520 list (the allocator,
+ * appendData, storage, chunk, node block, spare node, skip list and version fields of List, and the chunk
+ * position of ListIterator), and both are allocated and copied by value by callers.  Their layout is not
+ * binary compatible with the original header: code and libraries built against it, such as an old
+ * liblist.so, must be recompiled.  See GPXParser.h for the structs of the parser.
  */
 
 #ifndef _LIST_API_
@@ -13,6 +19,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <stdarg.h>
 
 /**
  * Node of a linked list. This list is doubly linked, meaning that it has points to both the node immediately in front 
@@ -24,6 +31,46 @@ typedef struct listNode{
     struct listNode* next;
 } Node;
 
+/**
+ * Optional allocator for the Node structs of a list, and for the List struct itself.
+ * allocate must return zeroed memory, or NULL on failure.  release may do nothing, e.g. for
+ * region allocators that free all of their memory at once.
+ **/
+typedef struct listAllocator{
+    void* (*allocate)(void* context, size_t size);
+    void (*release)(void* context, void* toBeReleased);
+    void* context;
+} ListAllocator;
+
+/**
+ * How a list stores its elements, chosen when it is initialized.
+ * LIST_LINKED keeps every element in a Node of its own.
+ * LIST_UNROLLED keeps the elements in chunks of up to LIST_CHUNK_CAPACITY pointers, which takes a fraction
+ * of the memory of a long list and makes insertBack several times faster.  nextElement walks it faster than
+ * a list of nodes, and nextElements, which hands out a chunk per call, several times faster.  An unrolled list
+ * has no Node structs, so its head and tail stay NULL.
+ * LIST_SORTED keeps the elements in the order of the compare function of the list, whichever insert function
+ * adds them.  Its nodes also form a skip list, so insertSorted, deleteDataFromList and findSortedElement take
+ * O(log n) instead of a walk along the list.
+ **/
+typedef enum listStorage{
+    LIST_LINKED,
+    LIST_UNROLLED,
+    LIST_SORTED
+} ListStorage;
+
+#define LIST_CHUNK_CAPACITY 32
+
+/**
+ * Growable string.  text is always NUL-terminated once something has been appended, length is strlen(text),
+ * and the buffer grows geometrically, so building a string of n characters costs O(n) in total.
+ **/
+typedef struct stringBuilder{
+    char* text;
+    size_t length;
+    size_t capacity;
+} StringBuilder;
+
 /**
  * Metadata head of the list. 
  * Contains no actual data but contains
@@ -37,6 +84,24 @@ typedef struct listHead{
     void (*deleteData)(void* toBeDeleted);
     int (*compare)(const void* first,const void* second);
     char* (*printData)(void* toBePrinted);
+    //Allocator for the nodes of the list.  NULL if they come from malloc
+    ListAllocator* allocator;
+    //Optional version of printData that appends to a StringBuilder instead of returning a new string.  NULL if not set
+    void (*appendData)(StringBuilder* builder, void* toBeAppended);
+    //How the elements are stored.  LIST_LINKED unless the list was made by initializeListWithStorage
+    ListStorage storage;
+    //First and last chunk of a LIST_UNROLLED list, NULL while it is empty
+    struct listChunk* firstChunk;
+    struct listChunk* lastChunk;
+    //Blocks of nodes allocated together by insertBackBatch, released when the list is cleared
+    struct nodeBlock* nodeBlocks;
+    struct nodeBlock* lastNodeBlock;
+    //Nodes removed from a list that has node blocks, chained through next and reused by later inserts
+    Node* spareNodes;
+    //Upper levels of the skip list of a LIST_SORTED list, NULL until something is inserted
+    struct skipIndex* skipIndex;
+    //Changed by every function that adds, removes or reorders elements, see getListVersion
+    unsigned long version;
 } List;
 
 
@@ -47,6 +112,9 @@ typedef struct listHead{
  **/
 typedef struct iter{
     Node* current;
+    //Position in a LIST_UNROLLED list: the chunk and the index in it of the next element
+    struct listChunk* chunk;
+    int index;
 } ListIterator;
 
 
@@ -63,6 +131,33 @@ typedef struct iter{
 List* initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second));
 
 
+/** Function to initialize a list whose List struct and Node structs are obtained from a custom allocator
+* instead of malloc.  Otherwise identical to initializeList.
+*@pre function pointer arguments and allocator must not be NULL.  allocator must outlive the list.
+*@post List structure has been allocated from allocator and initialized
+*@return On success returns the new List struct. Returns NULL if any of the arguments are invalid or allocation fails
+*@param printFunction - function pointer to print a single node of the list
+*@param deleteFunction - function pointer to delete a single piece of data from the list
+*@param compareFunction - function pointer to compare two nodes of the list in order to test for equality or order
+*@param allocator - allocator used for every node of the list
+**/
+List* initializeListWithAllocator(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator);
+
+
+/** Function to initialize a list that stores its elements as storage says, with the List struct and the
+* nodes or chunks of the list obtained from allocator.  Otherwise identical to initializeList.
+*@pre function pointer arguments must not be NULL.  allocator, if not NULL, must outlive the list.
+*@post List structure has been allocated and initialized
+*@return On success returns the new List struct. Returns NULL if any of the arguments are invalid or allocation fails
+*@param printFunction - function pointer to print a single node of the list
+*@param deleteFunction - function pointer to delete a single piece of data from the list
+*@param compareFunction - function pointer to compare two nodes of the list in order to test for equality or order
+*@param storage - how the elements of the list are stored
+*@param allocator - allocator used for the list, or NULL to use malloc
+**/
+List* initializeListWithStorage(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListStorage storage, ListAllocator* allocator);
+
+
 
 /**Function for creating a node for the linked list. 
 * This node contains abstracted (void *) data as well as previous and next
@@ -97,6 +192,72 @@ void insertBack(List* list, void* toBeAdded);
 
 
 
+/**Node handles.  insertFrontNode, insertBackNode and insertSortedNode insert as insertFront, insertBack and
+* insertSorted do, and return the Node the element is kept in.  It stays valid until the element is removed or
+* the list is cleared, and lets removeNode and insertAfter work without a search.
+* Handles exist for LIST_LINKED and LIST_SORTED lists.  The elements of a LIST_UNROLLED list move between
+* chunks and have none, so these functions do nothing to such a list and return NULL.
+*@return the Node of the new element, or NULL if memory ran out
+**/
+Node* insertFrontNode(List* list, void* toBeAdded);
+Node* insertBackNode(List* list, void* toBeAdded);
+Node* insertSortedNode(List* list, void* toBeAdded);
+
+
+/**Inserts an element right after node in O(1), or at the front of the list if node is NULL.
+* Only for LIST_LINKED lists; a LIST_SORTED list chooses the place of every element itself.
+*@pre node is a node of list
+*@return the Node of the new element, or NULL if memory ran out or the list is not LIST_LINKED
+**/
+Node* insertAfter(List* list, Node* node, void* toBeAdded);
+
+
+/**Removes node from the list and returns its data, which is not deleted.  Takes O(1) for a LIST_LINKED list,
+* and O(log n) for a LIST_SORTED list.  The node is released, so its handle must not be used again.
+*@pre node is a node of list
+*@return the data of node, or NULL for a LIST_UNROLLED list
+**/
+void* removeNode(List* list, Node* node);
+
+
+
+/**Inserts count elements at the back of a list, in order, as count calls to insertBack would.
+* The nodes of a LIST_LINKED list are allocated together in one block, which is only released when the list
+* is cleared or freed.  From then on, the nodes of elements removed from the list are kept for the elements
+* inserted later, rather than released one at a time, and are released with the list.
+* A LIST_UNROLLED list is filled a whole chunk at a time, and a LIST_SORTED list places every item in order.
+* NULL items are skipped, as insertBack skips them.
+*@pre 'List' type must exist and be used in order to keep track of the linked list.
+*@param list pointer to the List struct
+*@param items - the data to be added to the linked list
+*@param count - the number of items
+*@return false if memory ran out, in which case none of the items were added
+**/
+bool insertBackBatch(List* list, void** items, int count);
+
+
+/**Moves every element of src to the back of dst in O(1), leaving src empty.  dst deletes the elements from
+* then on, so both lists must hold the same type of data.
+*@pre both lists exist
+*@param dst - the list to append to
+*@param src - the list whose elements are moved
+*@return false, with neither list changed, if dst is src, the lists store their elements differently or
+*        allocate them from different allocators, or they are LIST_SORTED lists, which a splice could put out of order
+**/
+bool spliceList(List* dst, List* src);
+
+
+/**Moves every element of src to the back of dst, leaving src empty.  Same as spliceList when the lists are
+* stored alike, and otherwise stores every element again in dst, in O(length of src).  The elements of a
+* LIST_SORTED dst go in order rather than at the back.
+*@pre both lists exist
+*@param dst - the list to append to
+*@param src - the list whose elements are moved
+*@return false, with neither list changed, if dst is src or memory ran out
+**/
+bool appendList(List* dst, List* src);
+
+
 /** Deletes the entire linked list, freeing all memory asssociated with the list, including the list struct itself.
 * Uses the supplied function pointer to release allocated memory for the data.
 * @pre 'List' type must exist and be used in order to keep track of the linked list.
@@ -120,6 +281,7 @@ void clearList(List* list);
 * should be used as the only insert function if a sorted list is required.  
 *@pre List exists and has memory allocated to it. Node to be added is valid.
 *@post The node to be added will be placed immediately before or after the first occurrence of a related node
+*       This takes O(log n) for a LIST_SORTED list, and a walk along the list otherwise.
 *@param list - a pointer to the List struct
 *@param toBeAdded - a pointer to data that is to be added to the linked list
 **/
@@ -127,6 +289,19 @@ void insertSorted(List* list, void* toBeAdded);
 
 
 
+/** Sorts the list with a stable merge sort, in O(n log n).  The nodes of a LIST_LINKED list are relinked in
+* place, with no memory allocated.  A LIST_SORTED list is always in the order of its own compare function,
+* and cannot be sorted in any other.
+*@pre List exists and has memory allocated to it
+*@post The elements are in the order compare gives them, with equal elements in the order they were in before
+*@param list - a pointer to the List struct
+*@param compare - compares two elements as the compare function of the list does, or NULL to use that function
+*@return false, with the list unchanged, if memory ran out or a LIST_SORTED list was given another compare function
+**/
+bool sortList(List* list, int (*compare)(const void* first, const void* second));
+
+
+
 /** Removes data from from the list, deletes the node and frees the memory,
  * changes pointer values of surrounding nodes to maintain list structure.
  * returns the data 
@@ -140,6 +315,16 @@ void insertSorted(List* list, void* toBeAdded);
 void* deleteDataFromList(List* list, void* toBeDeleted);
 
 
+/** Removes element itself from the list, found by its address rather than with the compare function, so that
+ * one of several equal elements can be removed.  The data is not deleted.  Takes a walk along the list.
+ *@pre List must exist and have memory allocated to it
+ *@param list - a pointer to the List struct
+ *@param element - the data of the element to remove
+ *@return false if element is not in the list
+ **/
+bool removeFromList(List* list, void* element);
+
+
 
 /**Returns a pointer to the data at the front of the list. Does not alter list structure.
  *@pre The list exists and has memory allocated to it
@@ -169,6 +354,51 @@ returned string must be freed by the calling function.
 char* toString(List* list);
 
 
+/**Appends the string representation of every element of the list to builder, from head to tail.
+ * Uses the list's appendData function pointer if it is set, and printData otherwise.
+ *@pre List must exist, but does not have to have elements.  builder has been initialized.
+ *@param list - a pointer to the List struct
+ *@param builder - the StringBuilder to append to
+ *@return false if memory ran out, in which case builder holds part of the list
+ **/
+bool appendListToString(List* list, StringBuilder* builder);
+
+
+/**Sets the function appendListToString and toString use to append an element of the list to a StringBuilder.
+ *@param list - a pointer to the List struct
+ *@param appendFunction - appends the representation of one element, as printData would return it
+ **/
+void setListAppender(List* list, void (*appendFunction)(StringBuilder* builder, void* toBeAppended));
+
+
+/** Initializes an empty StringBuilder.  No memory is allocated until something is appended
+ *@param builder - the StringBuilder to initialize
+ **/
+void initializeStringBuilder(StringBuilder* builder);
+
+
+/** Appends a string to builder.  A builder whose memory ran out ignores every later append
+ *@return false if memory ran out
+ **/
+bool appendString(StringBuilder* builder, const char* text);
+
+
+/** Appends text formatted as by printf to builder
+ *@return false if memory ran out
+ **/
+bool appendFormat(StringBuilder* builder, const char* format, ...);
+
+
+/** Hands the text of builder over to the caller, who must free it, and leaves builder empty.
+ *@return the text, "" if nothing was appended, or NULL if memory ran out while building it
+ **/
+char* finishStringBuilder(StringBuilder* builder);
+
+
+//Frees the text of builder and leaves it empty
+void freeStringBuilder(StringBuilder* builder);
+
+
 /** Function for creating an iterator for the linked list.  
  * Newly created iterator points to the head of the list.
  *@pre List exists and is valid
@@ -192,6 +422,25 @@ ListIterator createIterator(List* list);
 void* nextElement(ListIterator* iter);
 
 
+/** Returns the next elements that are stored next to each other and moves the iterator past them, so a loop
+* over a LIST_UNROLLED list reads a whole chunk per call instead of calling nextElement for every element.
+* Lists of nodes give one element per call.  Unlike nextElement, NULL elements do not end the iteration.
+*@return the number of elements at *elements, 0 at the end of the list
+*@param iter - a pointer to an iterator for a List struct.
+*@param elements - set to the first of the elements, which the others follow in memory
+**/
+int nextElements(ListIterator* iter, void*** elements);
+
+
+
+/** Returns the node of the next element, as nextElement returns its data, for use with removeNode and
+* insertAfter.  The iterator stays valid if the node it returned is removed.
+*@return the next Node, or NULL at the end of the list and for a LIST_UNROLLED list
+*@param iter - a pointer to an iterator for a List struct.
+**/
+Node* nextNode(ListIterator* iter);
+
+
 /**Returns the number of elements in the list.
  *@pre List must exist, but does not have to have elements.
  *@param list - a pointer to the List struct.
@@ -200,6 +449,16 @@ void* nextElement(ListIterator* iter);
 int getLength(List* list);
 
 
+/**Returns a number that changes whenever elements are added to, removed from or reordered in the list by the
+ * functions of this API, so a cache built from a list can tell that the list changed since, even if its length
+ * is the same.  Changes to the data the elements point to are not noticed.
+ *@pre List must exist
+ *@param list - a pointer to the List struct.
+ *@return the current version of the list
+ **/
+unsigned long getListVersion(List* list);
+
+
 /** Function that searches for an element in the list using a comparator function.
  * If an element is found, a pointer to the data of that element is returned
  * Returns NULL if the element is not found.
@@ -214,4 +473,15 @@ int getLength(List* list);
  **/
 void* findElement(List * list, bool (*customCompare)(const void* first,const void* second), const void* searchRecord);
 
+
+/** Function that searches for an element that the compare function of the list finds equal to searchRecord.
+ * Takes O(log n) for a LIST_SORTED list and a walk along the list otherwise.
+ *@pre List exists and is valid.
+ *@post List remains unchanged.
+ *@return The first element equal to searchRecord, or NULL if there is none.
+ *@param list - a pointer to the List sruct
+ *@param searchRecord - data of the same type as the elements of the list, as deleteDataFromList takes
+ **/
+void* findSortedElement(List* list, const void* searchRecord);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+#define ARENA_FIRST_BLOCK (64*1024)
+#define ARENA_MAX_BLOCK (64*1024*1024)
+#define ARENA_ALIGNMENT 16
+
+//A block of arena memory.  Allocations are carved out of the bytes that follow the header
+typedef struct arenaBlock{
+    struct arenaBlock* next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+//An element of a document in the arena that was allocated outside it, see adoptArenaElement
+typedef struct arenaElement{
+    struct arenaElement* next;
+    void* element;
+    void (*deleteElement)(void* data);
+} ArenaElement;
+
+//rounded up so that the first allocation in a block is aligned
+#define BLOCK_HEADER ((sizeof(ArenaBlock)+ARENA_ALIGNMENT-1)/ARENA_ALIGNMENT*ARENA_ALIGNMENT)
+
+static void* arenaListAllocate(void* context, size_t size){
+    return arenaAllocate((GPXArena*)context, size);
+}
+
+//arena memory is only ever released all at once by destroyArena
+static void arenaListRelease(void* context, void* toBeReleased){
+}
+
+GPXArena* createArena(void){
+    GPXArena* arena=calloc(1, sizeof(GPXArena));
+    if (arena==NULL){
+        return NULL;
+    }
+    arena->allocator.allocate=&arenaListAllocate;
+    arena->allocator.release=&arenaListRelease;
+    arena->allocator.context=arena;
+    arena->nextBlockSize=ARENA_FIRST_BLOCK;
+    return arena;
+}
+
+GPXArena* createChildArena(GPXArena* parent){
+    GPXArena* child=arenaAllocate(parent, sizeof(GPXArena));
+    if (child==NULL){
+        return NULL;
+    }
+    child->allocator.allocate=&arenaListAllocate;
+    child->allocator.release=&arenaListRelease;
+    child->allocator.context=child;
+    child->nextBlockSize=ARENA_FIRST_BLOCK;
+    return child;
+}
+
+void adoptChildArena(GPXArena* parent, GPXArena* child){
+    if (parent==NULL || child==NULL){
+        return;
+    }
+    //the child's blocks go behind the parent's, so the parent keeps allocating from its current block
+    ArenaBlock** tail=&parent->blocks;
+    while (*tail!=NULL){
+        tail=&(*tail)->next;
+    }
+    *tail=child->blocks;
+    child->blocks=NULL;
+    adoptArenaStrings(parent, child);
+    //lists built in the child now allocate from, and report, the parent
+    child->allocator.context=parent;
+}
+
+void* arenaAllocate(GPXArena* arena, size_t size){
+    if (arena==NULL){
+        return NULL;
+    }
+    size=(size+ARENA_ALIGNMENT-1)/ARENA_ALIGNMENT*ARENA_ALIGNMENT;
+    ArenaBlock* block=arena->blocks;
+    if (block==NULL || block->used+size>block->size){
+        //blocks double in size so a document only needs a handful of them
+        size_t blockSize=arena->nextBlockSize;
+        while (blockSize<size){
+            blockSize*=2;
+        }
+        if (arena->nextBlockSize<ARENA_MAX_BLOCK){
+            arena->nextBlockSize*=2;
+        }
+        //calloc'd blocks make every allocation zeroed, since arena memory is never reused
+        block=calloc(1, BLOCK_HEADER+blockSize);
+        if (block==NULL){
+            return NULL;
+        }
+        block->size=blockSize;
+        block->next=arena->blocks;
+        arena->blocks=block;
+    }
+    void* memory=(char*)block+BLOCK_HEADER+block->used;
+    block->used+=size;
+    return memory;
+}
+
+void destroyArena(GPXArena* arena){
+    if (arena==NULL){
+        return;
+    }
+    //adopted elements go first, while the arena memory they may point into still exists
+    ArenaElement* element=arena->elements;
+    while (element!=NULL){
+        ArenaElement* next=element->next;
+        element->deleteElement(element->element);
+        free(element);
+        element=next;
+    }
+    releaseArenaStrings(arena);
+    ArenaBlock* block=arena->blocks;
+    while (block!=NULL){
+        ArenaBlock* next=block->next;
+        free(block);
+        block=next;
+    }
+    free(arena);
+}
+
+bool arenaContains(const GPXArena* arena, const void* memory){
+    if (arena==NULL || memory==NULL){
+        return false;
+    }
+    for (const ArenaBlock* block=arena->blocks; block!=NULL; block=block->next){
+        const char* start=(const char*)block+BLOCK_HEADER;
+        if ((const char*)memory>=start && (const char*)memory<start+block->used){
+            return true;
+        }
+    }
+    return false;
+}
+
+//the elements are kept on the heap rather than in the arena, so that adding and removing one in a loop
+//does not grow the arena
+bool adoptArenaElement(GPXArena* arena, void* element, void (*deleteElement)(void* data)){
+    if (arena==NULL || element==NULL){
+        return false;
+    }
+    ArenaElement* adopted=malloc(sizeof(ArenaElement));
+    if (adopted==NULL){
+        return false;
+    }
+    adopted->element=element;
+    adopted->deleteElement=deleteElement;
+    adopted->next=arena->elements;
+    arena->elements=adopted;
+    return true;
+}
+
+bool releaseArenaElement(GPXArena* arena, void* element){
+    if (arena==NULL){
+        return false;
+    }
+    for (ArenaElement** link=&arena->elements; *link!=NULL; link=&(*link)->next){
+        if ((*link)->element==element){
+            ArenaElement* released=*link;
+            *link=released->next;
+            free(released);
+            return true;
+        }
+    }
+    return false;
+}
+
+GPXArena* getListArena(List* list){
+    if (list==NULL || list->allocator==NULL || list->allocator->allocate!=&arenaListAllocate){
+        return NULL;
+    }
+    return (GPXArena*)list->allocator->context;
+}
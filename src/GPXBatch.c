@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+typedef struct {
+    char** fileNames;
+    const GPXParseOptions* options;
+    GPXBatchResult* results;
+} BatchJob;
+
+static void parseOne(void* context, int index, int worker){
+    BatchJob* job=context;
+    GPXBatchResult* result=&job->results[index];
+    char* fileName=job->fileNames[index];
+    if (fileName==NULL || strcmp(fileName, "")==0){
+        result->error=GPX_BATCH_FILE_ERROR;
+        return;
+    }
+    FILE* file=fopen(fileName, "r");
+    if (file==NULL){
+        result->error=GPX_BATCH_FILE_ERROR;
+        return;
+    }
+    fclose(file);
+    //the build context is per thread, so documents built side by side do not share it
+    result->doc=createGPXdocWithOptions(fileName, job->options);
+    result->error=(result->doc!=NULL) ? GPX_BATCH_OK : GPX_BATCH_PARSE_ERROR;
+}
+
+GPXBatchResult* createGPXdocBatch(char** fileNames, int numFiles, int numThreads, const GPXParseOptions* options){
+    if (fileNames==NULL || numFiles<=0){
+        return NULL;
+    }
+    GPXBatchResult* results=calloc(numFiles, sizeof(GPXBatchResult));
+    if (results==NULL){
+        return NULL;
+    }
+    //libxml2 sets up its global state here; doing it before the workers start keeps them from racing to do it
+    xmlInitParser();
+
+    BatchJob job;
+    job.fileNames=fileNames;
+    job.options=options;
+    job.results=results;
+    if (runParallel(numThreads, numFiles, &parseOne, &job)==false){
+        free(results);
+        return NULL;
+    }
+    return results;
+}
+
+void deleteGPXBatch(GPXBatchResult* results, int numFiles){
+    if (results==NULL){
+        return;
+    }
+    for (int i=0; i<numFiles; i++){
+        deleteGPXdoc(results[i].doc);
+    }
+    free(results);
+}
@@ -0,0 +1,802 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//The file is a header followed by ten sections, each starting on an 8-byte boundary:
+//four point columns (latitude, longitude, elevation, time), the point, route, track, segment and
+//GPXData records, and a table of NUL-terminated strings that the records refer to by offset.
+//Every number is little-endian.  The waypoints of the document are points [0, numWaypoints).
+
+//\r\n catches files that went through a text-mode transfer
+#define BINARY_MAGIC "GPXBIN\r\n"
+#define BINARY_FORMAT_VERSION 1
+
+enum {
+    SECTION_LATITUDE,
+    SECTION_LONGITUDE,
+    SECTION_ELEVATION,
+    SECTION_TIME,
+    SECTION_POINTS,
+    SECTION_ROUTES,
+    SECTION_TRACKS,
+    SECTION_SEGMENTS,
+    SECTION_DATA,
+    SECTION_STRINGS,
+    NUM_SECTIONS
+};
+
+//SegmentRecord.flags
+#define SEGMENT_COLUMNAR 1
+#define SEGMENT_HAS_ELEVATION 2
+#define SEGMENT_HAS_TIME 4
+
+typedef struct {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    //checksum of every byte after the header
+    uint64_t payloadChecksum;
+    double gpxVersion;
+    uint32_t creator;
+    uint32_t namespace;
+    uint32_t numPoints;
+    uint32_t numWaypoints;
+    uint32_t numRoutes;
+    uint32_t numTracks;
+    uint32_t numSegments;
+    uint32_t numData;
+    uint64_t sectionOffsets[NUM_SECTIONS];
+    uint64_t sectionSizes[NUM_SECTIONS];
+    //checksum of the header up to this field
+    uint64_t headerChecksum;
+} BinaryHeader;
+
+_Static_assert(sizeof(BinaryHeader)%8==0, "sections after the header must stay aligned");
+
+//Strings are offsets into the string table, where offset 0 is the empty string
+typedef struct {
+    uint32_t name;
+    uint32_t firstData;
+    uint32_t numData;
+} PointRecord;
+
+//A route, whose children are points, or a track, whose children are segments
+typedef struct {
+    uint32_t name;
+    uint32_t firstData;
+    uint32_t numData;
+    uint32_t firstChild;
+    uint32_t numChildren;
+} ElementRecord;
+
+typedef struct {
+    uint32_t firstPoint;
+    uint32_t numPoints;
+    uint32_t flags;
+} SegmentRecord;
+
+typedef struct {
+    uint32_t name;
+    uint32_t value;
+} DataRecord;
+
+struct gpxBinary{
+    unsigned char* base;
+    size_t size;
+    const BinaryHeader* header;
+    const double* latitude;
+    const double* longitude;
+    const double* elevation;
+    const int64_t* time;
+    const PointRecord* points;
+    const ElementRecord* routes;
+    const ElementRecord* tracks;
+    const SegmentRecord* segments;
+    const DataRecord* data;
+    const char* strings;
+    uint64_t stringBytes;
+};
+
+static bool isLittleEndian(void){
+    uint16_t one=1;
+    unsigned char first;
+    memcpy(&first, &one, 1);
+    return first==1;
+}
+
+//64-bit multiply-rotate hash, a word at a time
+static uint64_t checksum(const unsigned char* bytes, size_t length){
+    uint64_t hash=0x9E3779B97F4A7C15ULL^length;
+    size_t i=0;
+    for (; i+8<=length; i+=8){
+        uint64_t word;
+        memcpy(&word, bytes+i, 8);
+        hash=((hash<<29)|(hash>>35))^word;
+        hash*=0x100000001B3ULL;
+    }
+    uint64_t tail=0;
+    memcpy(&tail, bytes+i, length-i);
+    hash=((hash<<29)|(hash>>35))^tail;
+    hash*=0x100000001B3ULL;
+    return hash^(hash>>32);
+}
+
+/////////////////////////////////SAVING/////////////////////////////////
+
+//Sizes of everything in the file, worked out before it is written
+typedef struct {
+    uint64_t numPoints;
+    uint64_t numWaypoints;
+    uint64_t numRoutes;
+    uint64_t numTracks;
+    uint64_t numSegments;
+    uint64_t numData;
+    uint64_t stringBytes;
+} BinaryCounts;
+
+typedef struct {
+    unsigned char* base;
+    double* latitude;
+    double* longitude;
+    double* elevation;
+    int64_t* time;
+    PointRecord* points;
+    ElementRecord* routes;
+    ElementRecord* tracks;
+    SegmentRecord* segments;
+    DataRecord* data;
+    char* strings;
+    uint32_t nextPoint;
+    uint32_t nextSegment;
+    uint32_t nextData;
+    uint32_t nextString;
+} BinaryWriter;
+
+static uint64_t stringSize(const char* string){
+    return (string==NULL || string[0]=='\0') ? 0 : strlen(string)+1;
+}
+
+static void countData(BinaryCounts* counts, List* otherData){
+    ListIterator iter=createIterator(otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        counts->numData++;
+        counts->stringBytes+=stringSize(d->name)+stringSize(d->value);
+    }
+}
+
+static void countPoints(BinaryCounts* counts, List* waypoints){
+    ListIterator iter=createIterator(waypoints);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        counts->numPoints++;
+        counts->stringBytes+=stringSize(w->name);
+        countData(counts, w->otherData);
+        GPXFieldText texts[GPX_NUM_POINT_FIELDS];
+        int numTexts=getOmittedPointData(w, texts);
+        for (int i=0; i<numTexts; i++){
+            counts->numData++;
+            counts->stringBytes+=stringSize(texts[i].name)+stringSize(texts[i].value);
+        }
+    }
+}
+
+static void countDoc(BinaryCounts* counts, const GPXdoc* doc){
+    memset(counts, 0, sizeof(BinaryCounts));
+    //the empty string at offset 0
+    counts->stringBytes=1+stringSize(doc->creator)+stringSize(doc->namespace);
+    countPoints(counts, doc->waypoints);
+    counts->numWaypoints=counts->numPoints;
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        counts->numRoutes++;
+        counts->stringBytes+=stringSize(r->name);
+        countData(counts, r->otherData);
+        countPoints(counts, r->waypoints);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        counts->numTracks++;
+        counts->stringBytes+=stringSize(t->name);
+        countData(counts, t->otherData);
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            counts->numSegments++;
+            if (isColumnarSegment(s)){
+                counts->numPoints+=s->columns->length;
+            }
+            else{
+                countPoints(counts, s->waypoints);
+            }
+        }
+    }
+}
+
+static uint32_t writeString(BinaryWriter* writer, const char* string){
+    uint64_t size=stringSize(string);
+    if (size==0){
+        return 0;
+    }
+    uint32_t offset=writer->nextString;
+    memcpy(writer->strings+offset, string, size);
+    writer->nextString+=size;
+    return offset;
+}
+
+static void writeData(BinaryWriter* writer, List* otherData, uint32_t* firstData, uint32_t* numData){
+    *firstData=writer->nextData;
+    ListIterator iter=createIterator(otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        DataRecord* record=&writer->data[writer->nextData++];
+        record->name=writeString(writer, d->name);
+        record->value=writeString(writer, d->value);
+    }
+    *numData=writer->nextData-*firstData;
+}
+
+static void writeDataRecord(BinaryWriter* writer, const char* name, const char* value){
+    DataRecord* record=&writer->data[writer->nextData++];
+    record->name=writeString(writer, name);
+    record->value=writeString(writer, value);
+}
+
+//The GPXData of a point.  Fields that are only kept typed are saved as the GPXData they came from,
+//at the position the schema gives them, as writeGPXdoc writes them
+static void writePointData(BinaryWriter* writer, const Waypoint* w, PointRecord* record){
+    GPXFieldText texts[GPX_NUM_POINT_FIELDS];
+    int numTexts=getOmittedPointData(w, texts);
+    int next=0;
+    record->firstData=writer->nextData;
+    ListIterator iter=createIterator(w->otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        int rank=getPointChildRank(d->name);
+        for (; next<numTexts && texts[next].rank<rank; next++){
+            writeDataRecord(writer, texts[next].name, texts[next].value);
+        }
+        writeDataRecord(writer, d->name, d->value);
+    }
+    for (; next<numTexts; next++){
+        writeDataRecord(writer, texts[next].name, texts[next].value);
+    }
+    record->numData=writer->nextData-record->firstData;
+}
+
+//writes the points of a list, adding SEGMENT_HAS_ELEVATION/SEGMENT_HAS_TIME to flags if any point has one
+static void writePoints(BinaryWriter* writer, List* waypoints, uint32_t* flags){
+    ListIterator iter=createIterator(waypoints);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        uint32_t i=writer->nextPoint++;
+        writer->latitude[i]=w->latitude;
+        writer->longitude[i]=w->longitude;
+        getPointColumns(w, &writer->elevation[i], &writer->time[i]);
+        if (isnan(writer->elevation[i])==false){
+            *flags|=SEGMENT_HAS_ELEVATION;
+        }
+        if (writer->time[i]!=GPX_NO_TIME){
+            *flags|=SEGMENT_HAS_TIME;
+        }
+        PointRecord* record=&writer->points[i];
+        record->name=writeString(writer, w->name);
+        writePointData(writer, w, record);
+    }
+}
+
+static void writeColumns(BinaryWriter* writer, const SegmentColumns* columns, uint32_t* flags){
+    uint32_t first=writer->nextPoint;
+    memcpy(writer->latitude+first, columns->latitude, sizeof(double)*columns->length);
+    memcpy(writer->longitude+first, columns->longitude, sizeof(double)*columns->length);
+    for (int i=0; i<columns->length; i++){
+        writer->elevation[first+i]=(columns->elevation!=NULL) ? columns->elevation[i] : NAN;
+        writer->time[first+i]=(columns->time!=NULL) ? columns->time[i] : GPX_NO_TIME;
+    }
+    //points of columnar segments have no names or data; the records are zeroed already
+    writer->nextPoint+=columns->length;
+    *flags|=SEGMENT_COLUMNAR;
+    *flags|=(columns->elevation!=NULL) ? SEGMENT_HAS_ELEVATION : 0;
+    *flags|=(columns->time!=NULL) ? SEGMENT_HAS_TIME : 0;
+}
+
+static void writeDoc(BinaryWriter* writer, BinaryHeader* header, const GPXdoc* doc){
+    header->creator=writeString(writer, doc->creator);
+    header->namespace=writeString(writer, doc->namespace);
+    uint32_t unused=0;
+    writePoints(writer, doc->waypoints, &unused);
+
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    ElementRecord* record=writer->routes;
+    while ((r=nextElement(&routes))!=NULL){
+        record->name=writeString(writer, r->name);
+        writeData(writer, r->otherData, &record->firstData, &record->numData);
+        record->firstChild=writer->nextPoint;
+        writePoints(writer, r->waypoints, &unused);
+        record->numChildren=writer->nextPoint-record->firstChild;
+        record++;
+    }
+
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    record=writer->tracks;
+    while ((t=nextElement(&tracks))!=NULL){
+        record->name=writeString(writer, t->name);
+        writeData(writer, t->otherData, &record->firstData, &record->numData);
+        record->firstChild=writer->nextSegment;
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            SegmentRecord* segment=&writer->segments[writer->nextSegment++];
+            segment->firstPoint=writer->nextPoint;
+            if (isColumnarSegment(s)){
+                writeColumns(writer, s->columns, &segment->flags);
+            }
+            else{
+                writePoints(writer, s->waypoints, &segment->flags);
+            }
+            segment->numPoints=writer->nextPoint-segment->firstPoint;
+        }
+        record->numChildren=writer->nextSegment-record->firstChild;
+        record++;
+    }
+}
+
+bool saveGPXBinary(const GPXdoc* doc, const char* fileName){
+    if (doc==NULL || fileName==NULL || strcmp(fileName, "")==0 || isLittleEndian()==false){
+        return false;
+    }
+    BinaryCounts counts;
+    countDoc(&counts, doc);
+    //records refer to points, data and strings with 32-bit indices
+    if (counts.numPoints>UINT32_MAX || counts.numData>UINT32_MAX || counts.stringBytes>UINT32_MAX){
+        return false;
+    }
+
+    uint64_t sizes[NUM_SECTIONS];
+    sizes[SECTION_LATITUDE]=counts.numPoints*sizeof(double);
+    sizes[SECTION_LONGITUDE]=counts.numPoints*sizeof(double);
+    sizes[SECTION_ELEVATION]=counts.numPoints*sizeof(double);
+    sizes[SECTION_TIME]=counts.numPoints*sizeof(int64_t);
+    sizes[SECTION_POINTS]=counts.numPoints*sizeof(PointRecord);
+    sizes[SECTION_ROUTES]=counts.numRoutes*sizeof(ElementRecord);
+    sizes[SECTION_TRACKS]=counts.numTracks*sizeof(ElementRecord);
+    sizes[SECTION_SEGMENTS]=counts.numSegments*sizeof(SegmentRecord);
+    sizes[SECTION_DATA]=counts.numData*sizeof(DataRecord);
+    sizes[SECTION_STRINGS]=counts.stringBytes;
+    uint64_t offsets[NUM_SECTIONS];
+    uint64_t fileSize=sizeof(BinaryHeader);
+    for (int i=0; i<NUM_SECTIONS; i++){
+        offsets[i]=fileSize;
+        fileSize=(fileSize+sizes[i]+7)/8*8;
+    }
+
+    unsigned char* base=calloc(1, fileSize);
+    if (base==NULL){
+        return false;
+    }
+    BinaryHeader* header=(BinaryHeader*)base;
+    memcpy(header->magic, BINARY_MAGIC, sizeof(header->magic));
+    header->formatVersion=BINARY_FORMAT_VERSION;
+    header->headerSize=sizeof(BinaryHeader);
+    header->fileSize=fileSize;
+    header->gpxVersion=doc->version;
+    header->numPoints=counts.numPoints;
+    header->numWaypoints=counts.numWaypoints;
+    header->numRoutes=counts.numRoutes;
+    header->numTracks=counts.numTracks;
+    header->numSegments=counts.numSegments;
+    header->numData=counts.numData;
+    memcpy(header->sectionOffsets, offsets, sizeof(offsets));
+    memcpy(header->sectionSizes, sizes, sizeof(sizes));
+
+    BinaryWriter writer;
+    memset(&writer, 0, sizeof(BinaryWriter));
+    writer.base=base;
+    writer.latitude=(double*)(base+offsets[SECTION_LATITUDE]);
+    writer.longitude=(double*)(base+offsets[SECTION_LONGITUDE]);
+    writer.elevation=(double*)(base+offsets[SECTION_ELEVATION]);
+    writer.time=(int64_t*)(base+offsets[SECTION_TIME]);
+    writer.points=(PointRecord*)(base+offsets[SECTION_POINTS]);
+    writer.routes=(ElementRecord*)(base+offsets[SECTION_ROUTES]);
+    writer.tracks=(ElementRecord*)(base+offsets[SECTION_TRACKS]);
+    writer.segments=(SegmentRecord*)(base+offsets[SECTION_SEGMENTS]);
+    writer.data=(DataRecord*)(base+offsets[SECTION_DATA]);
+    writer.strings=(char*)(base+offsets[SECTION_STRINGS]);
+    writer.nextString=1;
+    writeDoc(&writer, header, doc);
+
+    header->payloadChecksum=checksum(base+sizeof(BinaryHeader), fileSize-sizeof(BinaryHeader));
+    header->headerChecksum=checksum(base, offsetof(BinaryHeader, headerChecksum));
+
+    FILE* file=fopen(fileName, "wb");
+    if (file==NULL){
+        free(base);
+        return false;
+    }
+    bool written=(fwrite(base, 1, fileSize, file)==fileSize);
+    written=(fclose(file)==0) && written;
+    free(base);
+    if (written==false){
+        remove(fileName);
+    }
+    return written;
+}
+
+/////////////////////////////////LOADING/////////////////////////////////
+
+//checks that every section lies inside the file and has the size its count calls for.
+//Only the header is read, so this does not touch the pages of the sections
+static bool checkHeader(const BinaryHeader* header, size_t fileSize){
+    if (memcmp(header->magic, BINARY_MAGIC, sizeof(header->magic))!=0
+        || header->formatVersion!=BINARY_FORMAT_VERSION || header->headerSize!=sizeof(BinaryHeader)
+        || header->fileSize!=fileSize
+        || header->headerChecksum!=checksum((const unsigned char*)header, offsetof(BinaryHeader, headerChecksum))
+        || header->numWaypoints>header->numPoints){
+        return false;
+    }
+    uint64_t expected[NUM_SECTIONS];
+    expected[SECTION_LATITUDE]=(uint64_t)header->numPoints*sizeof(double);
+    expected[SECTION_LONGITUDE]=(uint64_t)header->numPoints*sizeof(double);
+    expected[SECTION_ELEVATION]=(uint64_t)header->numPoints*sizeof(double);
+    expected[SECTION_TIME]=(uint64_t)header->numPoints*sizeof(int64_t);
+    expected[SECTION_POINTS]=(uint64_t)header->numPoints*sizeof(PointRecord);
+    expected[SECTION_ROUTES]=(uint64_t)header->numRoutes*sizeof(ElementRecord);
+    expected[SECTION_TRACKS]=(uint64_t)header->numTracks*sizeof(ElementRecord);
+    expected[SECTION_SEGMENTS]=(uint64_t)header->numSegments*sizeof(SegmentRecord);
+    expected[SECTION_DATA]=(uint64_t)header->numData*sizeof(DataRecord);
+    expected[SECTION_STRINGS]=header->sectionSizes[SECTION_STRINGS];
+    for (int i=0; i<NUM_SECTIONS; i++){
+        uint64_t offset=header->sectionOffsets[i];
+        uint64_t size=header->sectionSizes[i];
+        if (size!=expected[i] || offset%8!=0 || offset<sizeof(BinaryHeader) || offset>fileSize || size>fileSize-offset){
+            return false;
+        }
+    }
+    //the table starts with the empty string and ends with a NUL, so any offset into it is a valid string
+    uint64_t stringBytes=header->sectionSizes[SECTION_STRINGS];
+    return stringBytes>0 && stringBytes<=UINT32_MAX;
+}
+
+GPXBinary* mapGPXBinary(const char* fileName){
+    if (fileName==NULL || strcmp(fileName, "")==0 || isLittleEndian()==false){
+        return NULL;
+    }
+    int fd=open(fileName, O_RDONLY);
+    if (fd<0){
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info)!=0 || info.st_size<(off_t)sizeof(BinaryHeader)){
+        close(fd);
+        return NULL;
+    }
+    size_t size=info.st_size;
+    void* base=mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base==MAP_FAILED){
+        return NULL;
+    }
+
+    const BinaryHeader* header=base;
+    if (checkHeader(header, size)==false){
+        munmap(base, size);
+        return NULL;
+    }
+    const char* strings=(const char*)base+header->sectionOffsets[SECTION_STRINGS];
+    if (strings[0]!='\0' || strings[header->sectionSizes[SECTION_STRINGS]-1]!='\0'){
+        munmap(base, size);
+        return NULL;
+    }
+    GPXBinary* binary=calloc(1, sizeof(GPXBinary));
+    if (binary==NULL){
+        munmap(base, size);
+        return NULL;
+    }
+    unsigned char* bytes=base;
+    binary->base=bytes;
+    binary->size=size;
+    binary->header=header;
+    binary->latitude=(const double*)(bytes+header->sectionOffsets[SECTION_LATITUDE]);
+    binary->longitude=(const double*)(bytes+header->sectionOffsets[SECTION_LONGITUDE]);
+    binary->elevation=(const double*)(bytes+header->sectionOffsets[SECTION_ELEVATION]);
+    binary->time=(const int64_t*)(bytes+header->sectionOffsets[SECTION_TIME]);
+    binary->points=(const PointRecord*)(bytes+header->sectionOffsets[SECTION_POINTS]);
+    binary->routes=(const ElementRecord*)(bytes+header->sectionOffsets[SECTION_ROUTES]);
+    binary->tracks=(const ElementRecord*)(bytes+header->sectionOffsets[SECTION_TRACKS]);
+    binary->segments=(const SegmentRecord*)(bytes+header->sectionOffsets[SECTION_SEGMENTS]);
+    binary->data=(const DataRecord*)(bytes+header->sectionOffsets[SECTION_DATA]);
+    binary->strings=strings;
+    binary->stringBytes=header->sectionSizes[SECTION_STRINGS];
+    return binary;
+}
+
+bool verifyGPXBinary(const GPXBinary* binary){
+    if (binary==NULL){
+        return false;
+    }
+    return checksum(binary->base+sizeof(BinaryHeader), binary->size-sizeof(BinaryHeader))==binary->header->payloadChecksum;
+}
+
+void unmapGPXBinary(GPXBinary* binary){
+    if (binary==NULL){
+        return;
+    }
+    munmap(binary->base, binary->size);
+    free(binary);
+}
+
+/////////////////////////////////ACCESSORS/////////////////////////////////
+
+//Records are only checked when they are read, so that opening the file stays independent of its size.
+//Out of range references read as empty strings and empty ranges.
+
+static const char* getString(const GPXBinary* binary, uint32_t offset){
+    return (offset<binary->stringBytes) ? binary->strings+offset : "";
+}
+
+static bool inRange(uint32_t first, uint32_t count, uint32_t total){
+    return (uint64_t)first+count<=total;
+}
+
+static GPXBinaryPoints makePoints(const GPXBinary* binary, uint32_t first, uint32_t count){
+    GPXBinaryPoints points;
+    memset(&points, 0, sizeof(GPXBinaryPoints));
+    if (inRange(first, count, binary->header->numPoints)==false){
+        return points;
+    }
+    points.length=count;
+    points.latitude=binary->latitude+first;
+    points.longitude=binary->longitude+first;
+    points.elevation=binary->elevation+first;
+    points.time=binary->time+first;
+    points.firstPoint=first;
+    return points;
+}
+
+static const ElementRecord* getRecord(const GPXBinary* binary, GPXBinaryElement kind, int index){
+    if (binary==NULL || index<0){
+        return NULL;
+    }
+    if (kind==GPX_BINARY_ROUTE && index<(int64_t)binary->header->numRoutes){
+        return &binary->routes[index];
+    }
+    if (kind==GPX_BINARY_TRACK && index<(int64_t)binary->header->numTracks){
+        return &binary->tracks[index];
+    }
+    return NULL;
+}
+
+static const SegmentRecord* getSegmentRecord(const GPXBinary* binary, int track, int segment){
+    const ElementRecord* record=getRecord(binary, GPX_BINARY_TRACK, track);
+    if (record==NULL || segment<0 || segment>=(int64_t)record->numChildren
+        || inRange(record->firstChild, record->numChildren, binary->header->numSegments)==false){
+        return NULL;
+    }
+    return &binary->segments[record->firstChild+segment];
+}
+
+double getBinaryVersion(const GPXBinary* binary){
+    return (binary!=NULL) ? binary->header->gpxVersion : 0.0;
+}
+
+const char* getBinaryCreator(const GPXBinary* binary){
+    return (binary!=NULL) ? getString(binary, binary->header->creator) : NULL;
+}
+
+const char* getBinaryNamespace(const GPXBinary* binary){
+    return (binary!=NULL) ? getString(binary, binary->header->namespace) : NULL;
+}
+
+int getBinaryNumRoutes(const GPXBinary* binary){
+    return (binary!=NULL) ? (int)binary->header->numRoutes : 0;
+}
+
+int getBinaryNumTracks(const GPXBinary* binary){
+    return (binary!=NULL) ? (int)binary->header->numTracks : 0;
+}
+
+int getBinaryNumSegments(const GPXBinary* binary, int track){
+    const ElementRecord* record=getRecord(binary, GPX_BINARY_TRACK, track);
+    return (record!=NULL) ? (int)record->numChildren : 0;
+}
+
+GPXBinaryPoints getBinaryWaypoints(const GPXBinary* binary){
+    GPXBinaryPoints points;
+    memset(&points, 0, sizeof(GPXBinaryPoints));
+    return (binary!=NULL) ? makePoints(binary, 0, binary->header->numWaypoints) : points;
+}
+
+GPXBinaryPoints getBinaryRoutePoints(const GPXBinary* binary, int route){
+    const ElementRecord* record=getRecord(binary, GPX_BINARY_ROUTE, route);
+    GPXBinaryPoints points;
+    memset(&points, 0, sizeof(GPXBinaryPoints));
+    return (record!=NULL) ? makePoints(binary, record->firstChild, record->numChildren) : points;
+}
+
+GPXBinaryPoints getBinarySegmentPoints(const GPXBinary* binary, int track, int segment){
+    const SegmentRecord* record=getSegmentRecord(binary, track, segment);
+    GPXBinaryPoints points;
+    memset(&points, 0, sizeof(GPXBinaryPoints));
+    return (record!=NULL) ? makePoints(binary, record->firstPoint, record->numPoints) : points;
+}
+
+const char* getBinaryName(const GPXBinary* binary, GPXBinaryElement kind, int index){
+    if (kind==GPX_BINARY_POINT){
+        if (binary==NULL || index<0 || index>=(int64_t)binary->header->numPoints){
+            return NULL;
+        }
+        return getString(binary, binary->points[index].name);
+    }
+    const ElementRecord* record=getRecord(binary, kind, index);
+    return (record!=NULL) ? getString(binary, record->name) : NULL;
+}
+
+//finds the GPXData range of a point, route or track
+static bool getDataRange(const GPXBinary* binary, GPXBinaryElement kind, int index, uint32_t* first, uint32_t* count){
+    if (kind==GPX_BINARY_POINT){
+        if (binary==NULL || index<0 || index>=(int64_t)binary->header->numPoints){
+            return false;
+        }
+        *first=binary->points[index].firstData;
+        *count=binary->points[index].numData;
+    }
+    else{
+        const ElementRecord* record=getRecord(binary, kind, index);
+        if (record==NULL){
+            return false;
+        }
+        *first=record->firstData;
+        *count=record->numData;
+    }
+    return inRange(*first, *count, binary->header->numData);
+}
+
+int getBinaryNumData(const GPXBinary* binary, GPXBinaryElement kind, int index){
+    uint32_t first;
+    uint32_t count;
+    return getDataRange(binary, kind, index, &first, &count) ? (int)count : 0;
+}
+
+GPXDataView getBinaryData(const GPXBinary* binary, GPXBinaryElement kind, int index, int data){
+    GPXDataView view;
+    view.name=NULL;
+    view.value=NULL;
+    uint32_t first;
+    uint32_t count;
+    if (getDataRange(binary, kind, index, &first, &count) && data>=0 && data<(int64_t)count){
+        const DataRecord* record=&binary->data[first+data];
+        view.name=getString(binary, record->name);
+        view.value=getString(binary, record->value);
+    }
+    return view;
+}
+
+/////////////////////////////////CONVERSION/////////////////////////////////
+
+static bool addBinaryData(const GPXBinary* binary, GPXBinaryElement kind, int index, List* otherData){
+    int numData=getBinaryNumData(binary, kind, index);
+    for (int i=0; i<numData; i++){
+        GPXDataView view=getBinaryData(binary, kind, index, i);
+        GPXData* d=createGPXData((char*)view.name, (char*)view.value);
+        if (d==NULL){
+            return false;
+        }
+        insertBack(otherData, d);
+    }
+    return true;
+}
+
+static bool addBinaryPoints(const GPXBinary* binary, GPXBinaryPoints points, List* waypoints){
+    for (int i=0; i<points.length; i++){
+        int point=points.firstPoint+i;
+        Waypoint* w=createWaypoint((char*)getBinaryName(binary, GPX_BINARY_POINT, point), points.longitude[i], points.latitude[i]);
+        if (w==NULL){
+            return false;
+        }
+        insertBack(waypoints, w);
+        if (addBinaryData(binary, GPX_BINARY_POINT, point, w->otherData)==false){
+            return false;
+        }
+        decodePointData(w);
+    }
+    return true;
+}
+
+static TrackSegment* makeBinarySegment(const GPXBinary* binary, int track, int segment){
+    const SegmentRecord* record=getSegmentRecord(binary, track, segment);
+    if (record==NULL){
+        return NULL;
+    }
+    GPXBinaryPoints points=getBinarySegmentPoints(binary, track, segment);
+    TrackSegment* s=createTrackSegment();
+    if ((record->flags&SEGMENT_COLUMNAR)==0){
+        if (addBinaryPoints(binary, points, s->waypoints)==false){
+            deleteTrackSegment(s);
+            return NULL;
+        }
+        return s;
+    }
+    SegmentColumns* columns=allocateColumns(points.length, getBuildContext()->arena);
+    if (columns==NULL){
+        deleteTrackSegment(s);
+        return NULL;
+    }
+    setSegmentColumns(s, columns);
+    memcpy(s->columns->latitude, points.latitude, sizeof(double)*points.length);
+    memcpy(s->columns->longitude, points.longitude, sizeof(double)*points.length);
+    memcpy(s->columns->elevation, points.elevation, sizeof(double)*points.length);
+    memcpy(s->columns->time, points.time, sizeof(int64_t)*points.length);
+    if ((record->flags&SEGMENT_HAS_ELEVATION)==0){
+        s->columns->elevation=NULL;
+    }
+    if ((record->flags&SEGMENT_HAS_TIME)==0){
+        s->columns->time=NULL;
+    }
+    return s;
+}
+
+static bool addBinaryTracks(const GPXBinary* binary, GPXdoc* doc){
+    for (int t=0; t<getBinaryNumTracks(binary); t++){
+        Track* track=createTrack((char*)getBinaryName(binary, GPX_BINARY_TRACK, t));
+        if (track==NULL){
+            return false;
+        }
+        insertBack(doc->tracks, track);
+        if (addBinaryData(binary, GPX_BINARY_TRACK, t, track->otherData)==false){
+            return false;
+        }
+        for (int s=0; s<getBinaryNumSegments(binary, t); s++){
+            TrackSegment* segment=makeBinarySegment(binary, t, s);
+            if (segment==NULL){
+                return false;
+            }
+            insertBack(track->segments, segment);
+        }
+    }
+    return true;
+}
+
+GPXdoc* gpxBinaryToGPXdoc(const GPXBinary* binary){
+    if (binary==NULL){
+        return NULL;
+    }
+    //createEmptyGPXdoc takes the version as text; the exact value is copied in afterwards
+    GPXdoc* doc=createEmptyGPXdoc((char*)getBinaryNamespace(binary), "1", (char*)getBinaryCreator(binary));
+    if (doc==NULL){
+        return NULL;
+    }
+    doc->version=getBinaryVersion(binary);
+    bool success=addBinaryPoints(binary, getBinaryWaypoints(binary), doc->waypoints);
+    for (int r=0; success && r<getBinaryNumRoutes(binary); r++){
+        Route* route=createRoute((char*)getBinaryName(binary, GPX_BINARY_ROUTE, r));
+        if (route==NULL){
+            success=false;
+            break;
+        }
+        insertBack(doc->routes, route);
+        success=addBinaryData(binary, GPX_BINARY_ROUTE, r, route->otherData)
+             && addBinaryPoints(binary, getBinaryRoutePoints(binary, r), route->waypoints);
+    }
+    if (success){
+        success=addBinaryTracks(binary, doc);
+    }
+    if (success==false){
+        discardGPXdoc(doc);
+        return NULL;
+    }
+    recountGPXdoc(doc);
+    return doc;
+}
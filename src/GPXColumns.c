@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//reads exactly count decimal digits
+static bool readDigits(const char** text, int count, int* value){
+    int result=0;
+    for (int i=0; i<count; i++){
+        char c=(*text)[i];
+        if (c<'0' || c>'9'){
+            return false;
+        }
+        result=result*10+(c-'0');
+    }
+    *text+=count;
+    *value=result;
+    return true;
+}
+
+static bool isLeapYear(int year){
+    return (year%4==0 && year%100!=0) || year%400==0;
+}
+
+//days between 1970-01-01 and the given date of the proleptic Gregorian calendar
+static int64_t daysFromCivil(int year, int month, int day){
+    year-=(month<=2);
+    int64_t era=(year>=0 ? year : year-399)/400;
+    int64_t yearOfEra=year-era*400;
+    int64_t dayOfYear=(153*(month+(month>2 ? -3 : 9))+2)/5+day-1;
+    int64_t dayOfEra=yearOfEra*365+yearOfEra/4-yearOfEra/100+dayOfYear;
+    return era*146097+dayOfEra-719468;
+}
+
+bool parseGPXTime(const char* text, int64_t* nanoseconds){
+    static const int daysInMonth[12]={31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (text==NULL || nanoseconds==NULL){
+        return false;
+    }
+    const char* p=text;
+    int year, month, day, hour, minute, second;
+    if (readDigits(&p, 4, &year)==false || *p++!='-' || readDigits(&p, 2, &month)==false || *p++!='-'
+        || readDigits(&p, 2, &day)==false){
+        return false;
+    }
+    if (*p!='T' && *p!='t' && *p!=' '){
+        return false;
+    }
+    p++;
+    if (readDigits(&p, 2, &hour)==false || *p++!=':' || readDigits(&p, 2, &minute)==false || *p++!=':'
+        || readDigits(&p, 2, &second)==false){
+        return false;
+    }
+    if (month<1 || month>12 || day<1 || hour>23 || minute>59 || second>60){
+        return false;
+    }
+    if (day>daysInMonth[month-1]+(month==2 && isLeapYear(year))){
+        return false;
+    }
+
+    //fractional seconds beyond nanosecond precision are dropped
+    int64_t fraction=0;
+    if (*p=='.' || *p==','){
+        p++;
+        if (*p<'0' || *p>'9'){
+            return false;
+        }
+        int digits=0;
+        while (*p>='0' && *p<='9'){
+            if (digits<9){
+                fraction=fraction*10+(*p-'0');
+                digits++;
+            }
+            p++;
+        }
+        for (; digits<9; digits++){
+            fraction*=10;
+        }
+    }
+
+    //no designator means UTC, which is what GPX requires anyway
+    int offset=0;
+    if (*p=='Z' || *p=='z'){
+        p++;
+    }
+    else if (*p=='+' || *p=='-'){
+        int sign=(*p=='-') ? -1 : 1;
+        int offsetHours, offsetMinutes;
+        p++;
+        if (readDigits(&p, 2, &offsetHours)==false){
+            return false;
+        }
+        if (*p==':'){
+            p++;
+        }
+        if (readDigits(&p, 2, &offsetMinutes)==false || offsetHours>23 || offsetMinutes>59){
+            return false;
+        }
+        offset=sign*(offsetHours*3600+offsetMinutes*60);
+    }
+    if (*p!='\0'){
+        return false;
+    }
+
+    int64_t seconds=daysFromCivil(year, month, day)*86400+hour*3600+minute*60+second-offset;
+    *nanoseconds=seconds*1000000000LL+fraction;
+    return true;
+}
+
+//the date of the proleptic Gregorian calendar that is the given number of days after 1970-01-01
+static void civilFromDays(int64_t days, int* year, int* month, int* day){
+    days+=719468;
+    int64_t era=(days>=0 ? days : days-146096)/146097;
+    int64_t dayOfEra=days-era*146097;
+    int64_t yearOfEra=(dayOfEra-dayOfEra/1460+dayOfEra/36524-dayOfEra/146096)/365;
+    int64_t dayOfYear=dayOfEra-(365*yearOfEra+yearOfEra/4-yearOfEra/100);
+    int64_t monthIndex=(5*dayOfYear+2)/153;
+    *day=(int)(dayOfYear-(153*monthIndex+2)/5+1);
+    *month=(int)(monthIndex<10 ? monthIndex+3 : monthIndex-9);
+    *year=(int)(yearOfEra+era*400+(*month<=2));
+}
+
+bool formatGPXTime(int64_t nanoseconds, char* buffer, size_t size){
+    if (buffer==NULL || nanoseconds==GPX_NO_TIME){
+        return false;
+    }
+    //floor division, so times before 1970 still have a fraction in [0, 1s)
+    int64_t seconds=nanoseconds/1000000000LL;
+    int64_t fraction=nanoseconds%1000000000LL;
+    if (fraction<0){
+        fraction+=1000000000LL;
+        seconds--;
+    }
+    int64_t days=seconds/86400;
+    int64_t secondOfDay=seconds%86400;
+    if (secondOfDay<0){
+        secondOfDay+=86400;
+        days--;
+    }
+    int year, month, day;
+    civilFromDays(days, &year, &month, &day);
+    if (year<0 || year>9999){
+        return false;
+    }
+
+    char fractionText[12]="";
+    if (fraction!=0){
+        int digits=9;
+        while (fraction%10==0){
+            fraction/=10;
+            digits--;
+        }
+        snprintf(fractionText, sizeof(fractionText), ".%0*lld", digits, (long long)fraction);
+    }
+    int length=snprintf(buffer, size, "%04d-%02d-%02dT%02d:%02d:%02d%sZ", year, month, day,
+                        (int)(secondOfDay/3600), (int)(secondOfDay/60%60), (int)(secondOfDay%60), fractionText);
+    return length>0 && (size_t)length<size;
+}
+
+//Keys mixed with the address of the columns of a segment into its columnsTag, to tell what the columns hold.
+//The garbage in a segment made with malloc matches none of them, so it reads as having no columns
+#define COLUMNS_STORAGE_KEY ((uintptr_t)0x9e3779b97f4a7c15ULL)
+#define COLUMNS_CACHE_KEY ((uintptr_t)0xc2b2ae3d27d4eb4fULL)
+//a cache that invalidateSegmentColumns dropped, whose memory the next build reuses
+#define COLUMNS_STALE_KEY ((uintptr_t)0x165667b19e3779f9ULL)
+
+//The block of the columns cached for a segment that is not columnar, with the number of points it has room for
+typedef struct {
+    int capacity;
+    SegmentColumns columns;
+} ColumnsCache;
+
+//points the arrays of columns, one after the other, to the memory at arrays
+static void layOutColumns(SegmentColumns* columns, int length, void* arrays){
+    columns->length=length;
+    columns->latitude=arrays;
+    columns->longitude=columns->latitude+length;
+    columns->elevation=columns->longitude+length;
+    columns->time=(int64_t*)(columns->elevation+length);
+}
+
+static size_t getColumnsSize(int length){
+    return (size_t)length*(3*sizeof(double)+sizeof(int64_t));
+}
+
+SegmentColumns* allocateColumns(int length, GPXArena* arena){
+    size_t size=sizeof(SegmentColumns)+getColumnsSize(length);
+    SegmentColumns* columns=(arena!=NULL) ? arenaAllocate(arena, size) : gpxCalloc(1, size);
+    if (columns==NULL){
+        return NULL;
+    }
+    layOutColumns(columns, length, columns+1);
+    return columns;
+}
+
+static ColumnsCache* allocateCache(int capacity, GPXArena* arena){
+    size_t size=sizeof(ColumnsCache)+getColumnsSize(capacity);
+    ColumnsCache* cache=(arena!=NULL) ? arenaAllocate(arena, size) : malloc(size);
+    if (cache!=NULL){
+        cache->capacity=capacity;
+    }
+    return cache;
+}
+
+static bool hasColumns(const TrackSegment* segment, uintptr_t key){
+    return segment->columns!=NULL && segment->columnsTag==((uintptr_t)segment->columns^key);
+}
+
+static void tagColumns(TrackSegment* segment, uintptr_t key){
+    segment->columnsTag=(uintptr_t)segment->columns^key;
+}
+
+//the block of the cached columns of segment, whether or not they are up to date, NULL if it has none
+static ColumnsCache* getColumnsCache(const TrackSegment* segment){
+    if (hasColumns(segment, COLUMNS_CACHE_KEY)==false && hasColumns(segment, COLUMNS_STALE_KEY)==false){
+        return NULL;
+    }
+    return (ColumnsCache*)((char*)segment->columns-offsetof(ColumnsCache, columns));
+}
+
+void setSegmentColumns(TrackSegment* segment, SegmentColumns* columns){
+    segment->columns=columns;
+    tagColumns(segment, COLUMNS_STORAGE_KEY);
+}
+
+void freeSegmentColumns(TrackSegment* segment){
+    if (segment==NULL){
+        return;
+    }
+    if (isColumnarSegment(segment)){
+        free(segment->columns);
+    }
+    else{
+        free(getColumnsCache(segment));
+    }
+    segment->columns=NULL;
+    segment->columnsTag=0;
+}
+
+//stores the ele and time of a point, given as text, in row i of columns
+static void setColumnData(SegmentColumns* columns, int i, char* name, char* value, bool* hasElevation, bool* hasTime){
+    if (strcmp(name, "ele")==0 && parseGPXDecimal(value, &columns->elevation[i])){
+        *hasElevation=true;
+    }
+    else if (strcmp(name, "time")==0 && parseGPXTime(value, &columns->time[i])){
+        *hasTime=true;
+    }
+}
+
+//drops the ele and time arrays that no point used
+static void finishColumns(SegmentColumns* columns, bool hasElevation, bool hasTime){
+    if (hasElevation==false){
+        columns->elevation=NULL;
+    }
+    if (hasTime==false){
+        columns->time=NULL;
+    }
+}
+
+void getPointColumns(const Waypoint* w, double* elevation, int64_t* time){
+    //points the parser built have their values decoded already, and those are used even if otherData has
+    //been edited since, until refreshPointFields is called; others are decoded from their text
+    GPXPointFields fields=w->fields;
+    if ((fields.present&(GPX_POINT_ELEVATION|GPX_POINT_TIME))!=(GPX_POINT_ELEVATION|GPX_POINT_TIME)){
+        ListIterator iter=createIterator(w->otherData);
+        GPXData* d;
+        while ((d=nextElement(&iter))!=NULL){
+            decodePointField(&fields, d->name, d->value);
+        }
+    }
+    *elevation=(fields.present&GPX_POINT_ELEVATION) ? fields.elevation : NAN;
+    *time=(fields.present&GPX_POINT_TIME) ? fields.time : GPX_NO_TIME;
+}
+
+int64_t getPointTime(const Waypoint* w){
+    double elevation;
+    int64_t time;
+    getPointColumns(w, &elevation, &time);
+    return time;
+}
+
+SegmentColumns* makeSegmentColumns(xmlNode* node){
+    int length=0;
+    for (xmlNode* child = node->children; child!=NULL; child=child->next){
+        if (isElement(child) && strcmp((char*)child->name, "trkpt")==0){
+            length++;
+        }
+    }
+    SegmentColumns* columns=allocateColumns(length, NULL);
+    if (columns==NULL){
+        return NULL;
+    }
+
+    bool hasElevation=false;
+    bool hasTime=false;
+    int i=0;
+    for (xmlNode* child = node->children; child!=NULL; child=child->next){
+        if (isElement(child)==false || strcmp((char*)child->name, "trkpt")!=0){
+            continue;
+        }
+        //an invalid point fails the segment, the same as in makeTrackSegment
+        if (getCoordinates(child, &columns->latitude[i], &columns->longitude[i])==false
+            || columns->latitude[i]<-90.0 || columns->latitude[i]>90.0
+            || columns->longitude[i]<-180.0 || columns->longitude[i]>180.0){
+            if (getBuildContext()->arena==NULL){
+                free(columns);
+            }
+            return NULL;
+        }
+        columns->elevation[i]=NAN;
+        columns->time[i]=GPX_NO_TIME;
+        for (xmlNode* data = child->children; data!=NULL; data=data->next){
+            if (isElement(data) && data->children!=NULL && data->children->content!=NULL){
+                setColumnData(columns, i, (char*)data->name, (char*)data->children->content, &hasElevation, &hasTime);
+            }
+        }
+        i++;
+    }
+    columns->length=i;
+    finishColumns(columns, hasElevation, hasTime);
+    return columns;
+}
+
+bool isColumnarSegment(const TrackSegment* segment){
+    return segment!=NULL && hasColumns(segment, COLUMNS_STORAGE_KEY);
+}
+
+int getSegmentNumPoints(const TrackSegment* segment){
+    if (segment==NULL){
+        return 0;
+    }
+    return isColumnarSegment(segment) ? segment->columns->length : getLength(segment->waypoints);
+}
+
+void invalidateSegmentColumns(TrackSegment* segment){
+    //the memory is kept for the next build
+    if (segment!=NULL && hasColumns(segment, COLUMNS_CACHE_KEY)){
+        tagColumns(segment, COLUMNS_STALE_KEY);
+    }
+}
+
+SegmentColumns* getSegmentColumns(TrackSegment* segment){
+    if (segment==NULL){
+        return NULL;
+    }
+    if (isColumnarSegment(segment)){
+        return segment->columns;
+    }
+    unsigned long version=getListVersion(segment->waypoints);
+    if (hasColumns(segment, COLUMNS_CACHE_KEY) && segment->columnsVersion==version){
+        return segment->columns;
+    }
+    int length=getLength(segment->waypoints);
+
+    //the previous block is reused when the points fit in it.  The columns of a segment in an arena document
+    //have to live in the same arena, which only releases its blocks all at once, so one that is outgrown there
+    //is replaced by one at least twice as big, and a segment edited in a loop takes memory in proportion to its
+    //largest size rather than to the number of edits
+    GPXArena* arena=getListArena(segment->waypoints);
+    ColumnsCache* cache=getColumnsCache(segment);
+    if (cache==NULL || cache->capacity<length){
+        int capacity=length;
+        if (arena!=NULL && cache!=NULL && capacity<cache->capacity*2){
+            capacity=cache->capacity*2;
+        }
+        ColumnsCache* grown=allocateCache(capacity, arena);
+        if (grown==NULL){
+            return NULL;
+        }
+        if (arena==NULL){
+            free(cache);
+        }
+        cache=grown;
+    }
+    SegmentColumns* columns=&cache->columns;
+    layOutColumns(columns, length, cache+1);
+    bool hasElevation=false;
+    bool hasTime=false;
+    int i=0;
+    ListIterator iter=createIterator(segment->waypoints);
+    void** points;
+    int numPoints;
+    while ((numPoints=nextElements(&iter, &points))>0){
+        for (int j=0; j<numPoints; j++, i++){
+            const Waypoint* w=points[j];
+            columns->latitude[i]=w->latitude;
+            columns->longitude[i]=w->longitude;
+            getPointColumns(w, &columns->elevation[i], &columns->time[i]);
+            hasElevation=hasElevation || isnan(columns->elevation[i])==false;
+            hasTime=hasTime || columns->time[i]!=GPX_NO_TIME;
+        }
+    }
+    finishColumns(columns, hasElevation, hasTime);
+
+    segment->columns=columns;
+    tagColumns(segment, COLUMNS_CACHE_KEY);
+    segment->columnsVersion=version;
+    return columns;
+}
@@ -0,0 +1,295 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef GPX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//Decompressed text is handed to the parser in chunks.  With a thread of its own the decompressor fills
+//up to NUM_CHUNKS ahead of the parser, so the two overlap while memory stays bounded
+#define CHUNK_SIZE (64*1024)
+#define NUM_CHUNKS 4
+
+//Smaller inputs are decompressed on the parsing thread, where starting a thread would cost more than
+//the overlap saves
+#define MIN_THREADED_SIZE (256*1024)
+
+typedef struct {
+    char data[CHUNK_SIZE];
+    size_t length;
+} Chunk;
+
+typedef struct {
+    GPXCompression compression;
+    const unsigned char* next;
+    size_t left;
+    bool finished;
+    z_stream gzip;
+#ifdef GPX_HAVE_ZSTD
+    ZSTD_DStream* zstd;
+#endif
+
+    //the rest is only used with a decompression thread
+    bool threaded;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    Chunk* chunks;
+    int readIndex;
+    int filled;
+    size_t readOffset;
+    //set by the thread once it has decompressed everything, or failed
+    bool done;
+    bool failed;
+    //set by the parser when it stops reading early
+    bool stopping;
+} Decompressor;
+
+GPXCompression getInputCompression(const GPXInput* input){
+    const unsigned char* bytes=(const unsigned char*)input->buffer;
+    if (input->size>=2 && bytes[0]==0x1f && bytes[1]==0x8b){
+        return GPX_COMPRESSION_GZIP;
+    }
+    if (input->size>=4 && bytes[0]==0x28 && bytes[1]==0xb5 && bytes[2]==0x2f && bytes[3]==0xfd){
+        return GPX_COMPRESSION_ZSTD;
+    }
+    return GPX_COMPRESSION_NONE;
+}
+
+//zlib counts input in uInt, so a huge input is given to it a piece at a time
+static void refillGzip(Decompressor* d){
+    z_stream* z=&d->gzip;
+    if (z->avail_in==0 && d->left>0){
+        z->next_in=(Bytef*)d->next;
+        z->avail_in=(d->left<UINT_MAX) ? (uInt)d->left : UINT_MAX;
+        d->next+=z->avail_in;
+        d->left-=z->avail_in;
+    }
+}
+
+//Inflates into out, returns the number of bytes written, 0 at the end of the input, -1 if it is not valid.
+//A file of several gzip members, as made by concatenating .gz files, is read as one
+static int inflateChunk(Decompressor* d, char* out, size_t length){
+    z_stream* z=&d->gzip;
+    z->next_out=(Bytef*)out;
+    z->avail_out=(uInt)length;
+    while (z->avail_out==length && d->finished==false){
+        refillGzip(d);
+        int ret=inflate(z, Z_NO_FLUSH);
+        if (ret==Z_STREAM_END){
+            //anything after the last member other than another member is ignored, as gzip -d does
+            refillGzip(d);
+            bool another=(z->avail_in>=2 && z->next_in[0]==0x1f && z->next_in[1]==0x8b);
+            if (another==false || inflateReset(z)!=Z_OK){
+                d->finished=true;
+            }
+        }
+        else if (ret==Z_BUF_ERROR && z->avail_in==0 && d->left==0){
+            //the input ended in the middle of a member
+            return -1;
+        }
+        else if (ret!=Z_OK && ret!=Z_BUF_ERROR){
+            return -1;
+        }
+    }
+    return (int)(length-z->avail_out);
+}
+
+#ifdef GPX_HAVE_ZSTD
+//as inflateChunk; a file of several frames is read as one
+static int zstdChunk(Decompressor* d, char* out, size_t length){
+    ZSTD_outBuffer output={out, length, 0};
+    while (output.pos==0 && d->finished==false){
+        ZSTD_inBuffer input={d->next, d->left, 0};
+        size_t ret=ZSTD_decompressStream(d->zstd, &output, &input);
+        if (ZSTD_isError(ret)){
+            return -1;
+        }
+        d->next+=input.pos;
+        d->left-=input.pos;
+        if (output.pos==0 && d->left==0){
+            //0 once the last frame is complete; anything else with no input left to make progress on is a cut-short frame
+            if (ret==0){
+                d->finished=true;
+            }
+            else if (input.pos==0){
+                return -1;
+            }
+        }
+    }
+    return (int)output.pos;
+}
+#endif
+
+static int decompressChunk(Decompressor* d, char* out, size_t length){
+#ifdef GPX_HAVE_ZSTD
+    if (d->compression==GPX_COMPRESSION_ZSTD){
+        return zstdChunk(d, out, length);
+    }
+#endif
+    return inflateChunk(d, out, length);
+}
+
+static void* decompressInThread(void* data){
+    Decompressor* d=data;
+    int writeIndex=0;
+    while (true){
+        pthread_mutex_lock(&d->lock);
+        while (d->filled==NUM_CHUNKS && d->stopping==false){
+            pthread_cond_wait(&d->changed, &d->lock);
+        }
+        bool stopping=d->stopping;
+        pthread_mutex_unlock(&d->lock);
+        if (stopping){
+            return NULL;
+        }
+
+        //the parser does not touch a chunk that is not filled, so it is written without the lock
+        Chunk* chunk=&d->chunks[writeIndex];
+        int count=decompressChunk(d, chunk->data, CHUNK_SIZE);
+
+        pthread_mutex_lock(&d->lock);
+        if (count>0){
+            chunk->length=(size_t)count;
+            d->filled++;
+            writeIndex=(writeIndex+1)%NUM_CHUNKS;
+        }
+        d->failed=(count<0);
+        d->done=(count<=0);
+        pthread_cond_broadcast(&d->changed);
+        pthread_mutex_unlock(&d->lock);
+        if (count<=0){
+            return NULL;
+        }
+    }
+}
+
+static void freeDecompressor(Decompressor* d){
+    if (d->compression==GPX_COMPRESSION_GZIP){
+        inflateEnd(&d->gzip);
+    }
+#ifdef GPX_HAVE_ZSTD
+    ZSTD_freeDStream(d->zstd);
+#endif
+    free(d->chunks);
+    free(d);
+}
+
+static bool startThread(Decompressor* d){
+    d->chunks=malloc(NUM_CHUNKS*sizeof(Chunk));
+    if (d->chunks==NULL){
+        return false;
+    }
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->changed, NULL);
+    if (pthread_create(&d->thread, NULL, &decompressInThread, d)!=0){
+        pthread_mutex_destroy(&d->lock);
+        pthread_cond_destroy(&d->changed);
+        free(d->chunks);
+        d->chunks=NULL;
+        return false;
+    }
+    d->threaded=true;
+    return true;
+}
+
+void* openDecompressor(const GPXInput* input){
+    Decompressor* d=calloc(1, sizeof(Decompressor));
+    if (d==NULL){
+        return NULL;
+    }
+    d->compression=getInputCompression(input);
+    d->next=(const unsigned char*)input->buffer;
+    d->left=input->size;
+    if (d->compression==GPX_COMPRESSION_GZIP){
+        //15+16: a gzip header and trailer around the deflate data
+        if (inflateInit2(&d->gzip, 15+16)!=Z_OK){
+            free(d);
+            return NULL;
+        }
+    }
+    else if (d->compression==GPX_COMPRESSION_ZSTD){
+#ifdef GPX_HAVE_ZSTD
+        d->zstd=ZSTD_createDStream();
+        if (d->zstd==NULL){
+            free(d);
+            return NULL;
+        }
+#else
+        printf("error: zstd input is not supported by this build\n");
+        free(d);
+        return NULL;
+#endif
+    }
+    else{
+        free(d);
+        return NULL;
+    }
+
+    //without a thread, or if one cannot be started, the parser decompresses as it reads
+    if (input->size>=MIN_THREADED_SIZE && getProcessorCount()>1){
+        startThread(d);
+    }
+    return d;
+}
+
+int readDecompressed(void* context, char* buffer, int length){
+    Decompressor* d=context;
+    if (d->threaded==false){
+        return decompressChunk(d, buffer, (size_t)length);
+    }
+    pthread_mutex_lock(&d->lock);
+    while (d->filled==0 && d->done==false){
+        pthread_cond_wait(&d->changed, &d->lock);
+    }
+    //chunks filled before a failure are read before it is reported
+    if (d->filled==0){
+        int ret=d->failed ? -1 : 0;
+        pthread_mutex_unlock(&d->lock);
+        return ret;
+    }
+    Chunk* chunk=&d->chunks[d->readIndex];
+    size_t count=chunk->length-d->readOffset;
+    if (count>(size_t)length){
+        count=(size_t)length;
+    }
+    memcpy(buffer, chunk->data+d->readOffset, count);
+    d->readOffset+=count;
+    if (d->readOffset==chunk->length){
+        d->readOffset=0;
+        d->readIndex=(d->readIndex+1)%NUM_CHUNKS;
+        d->filled--;
+        pthread_cond_broadcast(&d->changed);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return (int)count;
+}
+
+int closeDecompressed(void* context){
+    Decompressor* d=context;
+    if (d->threaded){
+        pthread_mutex_lock(&d->lock);
+        d->stopping=true;
+        pthread_cond_broadcast(&d->changed);
+        pthread_mutex_unlock(&d->lock);
+        pthread_join(d->thread, NULL);
+        pthread_mutex_destroy(&d->lock);
+        pthread_cond_destroy(&d->changed);
+    }
+    freeDecompressor(d);
+    return 0;
+}
+
+bool finishDecompressed(void* context){
+    char rest[4096];
+    int count;
+    while ((count=readDecompressed(context, rest, sizeof(rest)))>0){
+    }
+    return count==0;
+}
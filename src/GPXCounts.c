@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//GPXData of a point, including the ones kept only as typed fields
+static int countPointData(const Waypoint* w){
+    int count=getLength(w->otherData);
+    for (unsigned int omitted=w->fields.textOmitted&w->fields.present; omitted!=0; omitted&=omitted-1){
+        count++;
+    }
+    return count;
+}
+
+static int countPointsData(List* points){
+    int count=0;
+    ListIterator iter=createIterator(points);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        count+=countPointData(w);
+    }
+    return count;
+}
+
+//the points of a columnar segment only have their <ele> and <time>
+int countSegmentGPXData(const TrackSegment* segment){
+    if (isColumnarSegment(segment)==false){
+        return countPointsData(segment->waypoints);
+    }
+    const SegmentColumns* columns=segment->columns;
+    int count=0;
+    for (int i=0; i<columns->length; i++){
+        count+=(columns->elevation!=NULL && isnan(columns->elevation[i])==false);
+        count+=(columns->time!=NULL && columns->time[i]!=GPX_NO_TIME);
+    }
+    return count;
+}
+
+static int countTrackData(const Track* t){
+    int count=getLength(t->otherData);
+    ListIterator iter=createIterator(t->segments);
+    TrackSegment* s;
+    while ((s=nextElement(&iter))!=NULL){
+        count+=countSegmentGPXData(s);
+    }
+    return count;
+}
+
+//adds the segments and GPXData of a waypoint, route or track to the two accumulators
+static void countElement(NameKind kind, const void* item, int* numSegments, int* numGPXData){
+    if (kind==NAME_WAYPOINT){
+        *numGPXData+=countPointData(item);
+    }
+    else if (kind==NAME_ROUTE){
+        const Route* r=item;
+        *numGPXData+=getLength(r->otherData)+countPointsData(r->waypoints);
+    }
+    else{
+        const Track* t=item;
+        *numSegments+=getLength(t->segments);
+        *numGPXData+=countTrackData(t);
+    }
+}
+
+//the versions of the lists only ever grow, so their sum changes whenever one of the lists does
+static unsigned long getDocVersion(const GPXdoc* doc){
+    return getListVersion(doc->waypoints)+getListVersion(doc->routes)+getListVersion(doc->tracks);
+}
+
+//the counts of every element of doc, walked from scratch
+static void countDoc(const GPXdoc* doc, int* numSegments, int* numGPXData){
+    *numSegments=0;
+    *numGPXData=0;
+    List* lists[]={doc->waypoints, doc->routes, doc->tracks};
+    NameKind kinds[]={NAME_WAYPOINT, NAME_ROUTE, NAME_TRACK};
+    for (int i=0; i<3; i++){
+        ListIterator iter=createIterator(lists[i]);
+        void* item;
+        while ((item=nextElement(&iter))!=NULL){
+            countElement(kinds[i], item, numSegments, numGPXData);
+        }
+    }
+}
+
+void recountGPXdoc(GPXdoc* doc){
+    if (doc!=NULL){
+        countDoc(doc, &doc->numSegments, &doc->numGPXData);
+        doc->countsVersion=getDocVersion(doc);
+    }
+}
+
+//the counts are a cache, so bringing them up to date does not count as modifying the document
+void updateGPXCounts(const GPXdoc* doc){
+    if (doc!=NULL && doc->countsVersion!=getDocVersion(doc)){
+        recountGPXdoc((GPXdoc*)doc);
+    }
+}
+
+void addElementCounts(GPXdoc* doc, NameKind kind, const void* item){
+    countElement(kind, item, &doc->numSegments, &doc->numGPXData);
+    doc->countsVersion=getDocVersion(doc);
+}
+
+void removeElementCounts(GPXdoc* doc, NameKind kind, const void* item){
+    int numSegments=0;
+    int numGPXData=0;
+    countElement(kind, item, &numSegments, &numGPXData);
+    doc->numSegments-=numSegments;
+    doc->numGPXData-=numGPXData;
+    doc->countsVersion=getDocVersion(doc);
+}
+
+bool verifyGPXCounts(const GPXdoc* doc){
+    if (doc==NULL){
+        return true;
+    }
+    int numSegments;
+    int numGPXData;
+    countDoc(doc, &numSegments, &numGPXData);
+    return numSegments==doc->numSegments && numGPXData==doc->numGPXData;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+#define EARTH_RADIUS 6371000.0
+
+//legs are measured in chunks that fit in L1, then summed
+#define LEG_CHUNK 512
+
+//With GCC on x86-64 Linux the leg kernel is compiled once per instruction set and the best one is
+//picked when the library is loaded: the default clone uses SSE2, which every x86-64 CPU has.
+//Everywhere else the same loop is compiled for the baseline target.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+    #define GPX_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+    #define GPX_TARGET_CLONES
+#endif
+
+//The kernel avoids libm so the compiler can vectorise it: sin and asin are polynomials, and every
+//branch is a select.  Both are accurate to a few ulps over the ranges they are used on.
+
+//Taylor series of sin, for |x| <= pi/2
+static inline double polySin(double x){
+    double x2=x*x;
+    double p=1.95729410633912626e-20;
+    p=p*x2-8.22063524662432950e-18;
+    p=p*x2+2.81145725434552060e-15;
+    p=p*x2-7.64716373181981641e-13;
+    p=p*x2+1.60590438368216133e-10;
+    p=p*x2-2.50521083854417202e-08;
+    p=p*x2+2.75573192239858925e-06;
+    p=p*x2-1.98412698412698413e-04;
+    p=p*x2+8.33333333333333322e-03;
+    p=p*x2-1.66666666666666657e-01;
+    p=p*x2+1.0;
+    return p*x;
+}
+
+//Taylor series of asin, for 0 <= x <= 0.5
+static inline double polyAsinSmall(double x){
+    double x2=x*x;
+    double p=2.48944867824688358e-03;
+    p=p*x2+2.65787063820729008e-03;
+    p=p*x2+2.84617840110894206e-03;
+    p=p*x2+3.05782164925803065e-03;
+    p=p*x2+3.29705950347348488e-03;
+    p=p*x2+3.56920539382593474e-03;
+    p=p*x2+3.88096455883766905e-03;
+    p=p*x2+4.24090709367936324e-03;
+    p=p*x2+4.66014348691509619e-03;
+    p=p*x2+5.15330968231990458e-03;
+    p=p*x2+5.74003767084192359e-03;
+    p=p*x2+6.44721031188964875e-03;
+    p=p*x2+7.31252587359884545e-03;
+    p=p*x2+8.39033580961681506e-03;
+    p=p*x2+9.76160952919407840e-03;
+    p=p*x2+1.15518008961397051e-02;
+    p=p*x2+1.39648437500000007e-02;
+    p=p*x2+1.73527644230769239e-02;
+    p=p*x2+2.23721590909090919e-02;
+    p=p*x2+3.03819444444444441e-02;
+    p=p*x2+4.46428571428571438e-02;
+    p=p*x2+7.49999999999999972e-02;
+    p=p*x2+1.66666666666666657e-01;
+    p=p*x2+1.00000000000000000e+00;
+    return p*x;
+}
+
+//asin for 0 <= x <= 1, using asin(x) = pi/2 - 2*asin(sqrt((1-x)/2)) above 0.5
+static inline double polyAsin(double x){
+    bool large=x>0.5;
+    double reflected=sqrt((1.0-x)*0.5);
+    double r=polyAsinSmall(large ? reflected : x);
+    return large ? M_PI/2-2.0*r : r;
+}
+
+//haversine distance in metres between two points given in radians
+static inline double legLength(double lat1, double lon1, double lat2, double lon2){
+    double sinLat=polySin((lat2-lat1)*0.5);
+    //sin^2 is symmetric around pi/2, which keeps the argument in the range of polySin
+    double halfLon=fabs(lon2-lon1)*0.5;
+    double sinLon=polySin(halfLon>M_PI/2 ? M_PI-halfLon : halfLon);
+    double cos1=polySin(M_PI/2-fabs(lat1));
+    double cos2=polySin(M_PI/2-fabs(lat2));
+    double a=sinLat*sinLat+cos1*cos2*sinLon*sinLon;
+    a=a<0.0 ? 0.0 : (a>1.0 ? 1.0 : a);
+    return 2.0*EARTH_RADIUS*polyAsin(sqrt(a));
+}
+
+GPX_TARGET_CLONES
+static void legKernel(const double* latitudes, const double* longitudes, int numLegs, double* distances){
+    const double toRadians=M_PI/180.0;
+    for (int i=0; i<numLegs; i++){
+        distances[i]=legLength(latitudes[i]*toRadians, longitudes[i]*toRadians,
+                               latitudes[i+1]*toRadians, longitudes[i+1]*toRadians);
+    }
+}
+
+double haversineDistance(double lat1, double lon1, double lat2, double lon2){
+    const double toRadians=M_PI/180.0;
+    double sinLat=sin((lat2-lat1)*toRadians*0.5);
+    double sinLon=sin((lon2-lon1)*toRadians*0.5);
+    double a=sinLat*sinLat+cos(lat1*toRadians)*cos(lat2*toRadians)*sinLon*sinLon;
+    return 2.0*EARTH_RADIUS*atan2(sqrt(a), sqrt(1.0-a));
+}
+
+void getLegDistances(const double* latitudes, const double* longitudes, int length, double* distances){
+    if (latitudes==NULL || longitudes==NULL || distances==NULL || length<2){
+        return;
+    }
+    legKernel(latitudes, longitudes, length-1, distances);
+}
+
+double getPathLength(const double* latitudes, const double* longitudes, int length){
+    if (latitudes==NULL || longitudes==NULL || length<2){
+        return 0.0;
+    }
+    double legs[LEG_CHUNK];
+    //independent partial sums, so the additions do not serialise on one register
+    double sums[4]={0.0, 0.0, 0.0, 0.0};
+    for (int start=0; start<length-1; start+=LEG_CHUNK){
+        int numLegs=length-1-start;
+        if (numLegs>LEG_CHUNK){
+            numLegs=LEG_CHUNK;
+        }
+        legKernel(latitudes+start, longitudes+start, numLegs, legs);
+        for (int i=0; i<numLegs; i++){
+            sums[i&3]+=legs[i];
+        }
+    }
+    return (sums[0]+sums[1])+(sums[2]+sums[3]);
+}
+
+//copies the coordinates of a list of waypoints into lat/lon starting at index offset, returns the new offset
+static int gatherWaypoints(List* waypoints, double* latitudes, double* longitudes, int offset){
+    ListIterator iter=createIterator(waypoints);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        latitudes[offset]=w->latitude;
+        longitudes[offset]=w->longitude;
+        offset++;
+    }
+    return offset;
+}
+
+float getRouteLen(const Route* rt){
+    if (rt==NULL){
+        return 0;
+    }
+    int length=getLength(rt->waypoints);
+    double* buffer=malloc(sizeof(double)*2*(length+1));
+    if (buffer==NULL){
+        return 0;
+    }
+    gatherWaypoints(rt->waypoints, buffer, buffer+length, 0);
+    double total=getPathLength(buffer, buffer+length, length);
+    free(buffer);
+    return (float)total;
+}
+
+float getTrackLen(const Track* tr){
+    if (tr==NULL){
+        return 0;
+    }
+    int length=0;
+    ListIterator iter=createIterator(tr->segments);
+    TrackSegment* segment;
+    while ((segment=nextElement(&iter))!=NULL){
+        length+=getSegmentNumPoints(segment);
+    }
+    double* buffer=malloc(sizeof(double)*2*(length+1));
+    if (buffer==NULL){
+        return 0;
+    }
+
+    //the segments are laid end to end, so the gap from one segment to the next is counted as well
+    double* latitudes=buffer;
+    double* longitudes=buffer+length;
+    int offset=0;
+    iter=createIterator(tr->segments);
+    while ((segment=nextElement(&iter))!=NULL){
+        if (isColumnarSegment(segment)){
+            memcpy(latitudes+offset, segment->columns->latitude, sizeof(double)*segment->columns->length);
+            memcpy(longitudes+offset, segment->columns->longitude, sizeof(double)*segment->columns->length);
+            offset+=segment->columns->length;
+        }
+        else{
+            offset=gatherWaypoints(segment->waypoints, latitudes, longitudes, offset);
+        }
+    }
+    double total=getPathLength(latitudes, longitudes, length);
+    free(buffer);
+    return (float)total;
+}
@@ -4,35 +4,56 @@
 #include "GPXHelpers.h"
 #include "GPXParser.h"
 
+static _Thread_local GPXBuildContext buildContext;
+
+GPXBuildContext* getBuildContext(void){
+    return &buildContext;
+}
+
+void* gpxCalloc(size_t count, size_t size){
+    if (buildContext.arena!=NULL){
+        return arenaAllocate(buildContext.arena, count*size);
+    }
+    return calloc(count, size);
+}
+
+//data in an arena list is freed along with the arena
+static void deleteNothing(void* data){
+}
+
+List* gpxInitializeList(char* (*printFunction)(void* toBePrinted),void (*appendFunction)(StringBuilder* builder, void* toBeAppended),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second)){
+    List* list;
+    if (buildContext.arena!=NULL){
+        list=initializeListWithStorage(printFunction, &deleteNothing, compareFunction, buildContext.listStorage, &buildContext.arena->allocator);
+    }
+    else{
+        list=initializeListWithStorage(printFunction, deleteFunction, compareFunction, buildContext.listStorage, NULL);
+    }
+    setListAppender(list, appendFunction);
+    return list;
+}
+
+void discardGPXdoc(GPXdoc* doc){
+    if (buildContext.arena==NULL){
+        deleteGPXdoc(doc);
+    }
+}
+
 char* fileOpener(char* filename){
-    if (filename==NULL){
+    if (filename==NULL || strcmp(filename, "")==0){
         return NULL;
     }
-    else if (strcmp(filename, "")==0){
+    GPXInput input;
+    if (openFileInput(filename, &input)==false){
         return NULL;
     }
-    else{
-        FILE* newFile=fopen(filename, "r");
-        fseek(newFile, 0L, SEEK_END);
-        unsigned long numBytes=ftell(newFile);
-        rewind(newFile);
-
-        char* content = calloc(numBytes +10, sizeof(char));
-        int counter=0;
-
-        while(1){
-            char c=fgetc(newFile);
-            if (feof(newFile)){
-                break;
-            }
-            else{
-                content[counter]=c;
-                counter++;
-            }
-        }
-        fclose(newFile);
-        return content;
+    char* content=malloc(input.size+1);
+    if (content!=NULL){
+        memcpy(content, input.buffer, input.size);
+        content[input.size]='\0';
     }
+    closeInput(&input);
+    return content;
 }
 
 char* stringCopy(char* string1, int startindex, int endindex){
@@ -40,52 +61,104 @@ char* stringCopy(char* string1, int startindex, int endindex){
     if (string1==NULL){
         return NULL;
     }
-    //check if startindex is out of bounds
-    if (startindex<0 || startindex>strlen(string1)){
+    //check if either index is out of bounds, or startindex is greater than endindex
+    size_t length=strlen(string1);
+    if (startindex<0 || endindex<0 || (size_t)endindex>length || startindex>endindex){
         return NULL;
     }
-    //check if endindex is out of bounds
-    if (endindex<0 || endindex>strlen(string1)){
+    //copy the chosen characters of string1, calloc'd so the copy is already terminated
+    char* string2=gpxCalloc((endindex-startindex)+1, sizeof(char));
+    if (string2!=NULL){
+        memcpy(string2, string1+startindex, endindex-startindex);
+    }
+    return string2;
+}
+
+///////////////////////CONSTRUCTORS/////////////////////////
+
+GPXdoc* createEmptyGPXdoc(char* namespace, char* version, char* creator){
+    if (version==NULL || creator==NULL){
         return NULL;
     }
-    //check if startindex is greater than endindex
-    if (startindex>endindex){
+    else if (strcmp(version, "")==0 || strcmp(creator, "")==0){
         return NULL;
     }
-    //set string2
-    char* string2=calloc((endindex-startindex)+10, sizeof(char));
-    //set counter for location in string2
-    int index=0;
-    //assign chosen characters in string1 to string2
-    for (int i=startindex; i<endindex; i++){
-        string2[index]=string1[i];
-        index++;
+    else{
+        //a version that is not a plain decimal is read as far as atof reads it, as it always was
+        double versionNumber;
+        if (parseGPXDecimal(version, &versionNumber)==false){
+            versionNumber=atof(version);
+        }
+        GPXdoc* newDoc = gpxCalloc(1, sizeof(GPXdoc));
+        if (namespace!=NULL){
+            strncpy(newDoc->namespace, namespace, sizeof(newDoc->namespace)-1);
+        }
+        newDoc->version=versionNumber;
+        newDoc->creator=stringCopy(creator, 0, strlen(creator));
+        newDoc->routes = gpxInitializeList(&routeToString, &appendRoute, &deleteRoute, &compareRoutes);
+        newDoc->tracks = gpxInitializeList(&trackToString, &appendTrack, &deleteTrack, &compareTracks);
+        newDoc->waypoints = gpxInitializeList(&waypointToString, &appendWaypoint, &deleteWaypoint, &compareWaypoints);
+        return newDoc;
     }
-    return string2;
 }
 
-///////////////////////CONSTRUCTORS/////////////////////////
+bool addGPXElement(GPXdoc* doc, xmlNode* node){
+    char* name=(char*)node->name;
+    if (strcmp(name, "wpt")==0){
+        Waypoint* w = makeWaypoint(node);
+        if (w==NULL){
+            return false;
+        }
+        insertBack(doc->waypoints, w);
+        addElementCounts(doc, NAME_WAYPOINT, w);
+    }
+    else if (strcmp(name, "rte")==0){
+        Route* r = makeRoute(node);
+        if (r==NULL){
+            return false;
+        }
+        insertBack(doc->routes, r);
+        addElementCounts(doc, NAME_ROUTE, r);
+    }
+    else if (strcmp(name, "trk")==0){
+        Track* t = makeTrack(node);
+        if (t==NULL){
+            return false;
+        }
+        insertBack(doc->tracks, t);
+        addElementCounts(doc, NAME_TRACK, t);
+    }
+    return true;
+}
 
 char* getName(xmlNode* node){
     xmlNode* newNode=NULL;
     for (xmlNode* n = node->children; n!=NULL; n=n->next){
-        char* name = (char*)n->name;
-        if (strcmp(name, "name")==0){
-            newNode= n->children;
+        if (isElement(n) && isName(n)){
+            newNode= n;
             break;
         }
     }
     if(newNode==NULL){
         return NULL;
     }
-    if(newNode->children==NULL){
-        return NULL;
-    }
-    char*name=(char*)newNode->children->content;
-    if (name==NULL){
+    //<name/> with no text child is an empty name, not a missing one
+    if(newNode->children==NULL || newNode->children->content==NULL){
         return "";
     }
-    return name;
+    return (char*)newNode->children->content;
+}
+
+char* getAttribute(xmlNode* node, char* name){
+    for(xmlAttr* a = node->properties; a!=NULL; a=a->next){
+        if (strcmp((char*)a->name, name)==0){
+            if (a->children==NULL || a->children->content==NULL){
+                return "";
+            }
+            return (char*)a->children->content;
+        }
+    }
+    return NULL;
 }
 
 GPXData* createGPXData(char* name, char* data){
@@ -93,15 +166,47 @@ GPXData* createGPXData(char* name, char* data){
         return NULL;
     }
     else{
-        GPXData* newdata = calloc(1, sizeof(GPXData));
+        //value is a flexible array member, so it has to be allocated along with the struct
+        GPXData* newdata = gpxCalloc(1, sizeof(GPXData)+strlen(data)+1);
+        if (newdata==NULL){
+            return NULL;
+        }
+        newdata->name=(char*)internArenaString(buildContext.arena, name);
+        if (newdata->name==NULL){
+            if (buildContext.arena==NULL){
+                free(newdata);
+            }
+            return NULL;
+        }
         strcpy(newdata->value, data);
-        strcpy(newdata->name, name);
         return newdata;
     }
 }
 
 GPXData* makeGPXData(xmlNode* node){
-    return createGPXData((char*)node->name, (char*)node->content);
+    //the value of an element lives in its text child, not in the element itself
+    if (node->children==NULL || node->children->content==NULL){
+        return NULL;
+    }
+    char* content=(char*)node->children->content;
+    if (strcmp(content, "")==0){
+        return NULL;
+    }
+    return createGPXData((char*)node->name, content);
+}
+
+//appends the GPXData of an element to list.  An empty element is not GPXData and is left out, the same in
+//every builder; returns false if the GPXData could not be created
+static bool insertElementData(List* list, xmlNode* node){
+    if (node->children==NULL || node->children->content==NULL || node->children->content[0]=='\0'){
+        return true;
+    }
+    GPXData* g=makeGPXData(node);
+    if (g==NULL){
+        return false;
+    }
+    insertBack(list, g);
+    return true;
 }
 
 Waypoint* createWaypoint(char* name, double longitude, double latitude){
@@ -115,36 +220,63 @@ Waypoint* createWaypoint(char* name, double longitude, double latitude){
         return NULL;
     }
     else{
-        Waypoint* newWaypoint = calloc(1, sizeof(Waypoint));
+        Waypoint* newWaypoint = gpxCalloc(1, sizeof(Waypoint));
         newWaypoint->name=stringCopy(name, 0, strlen(name));
-        newWaypoint->otherData=initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
+        newWaypoint->otherData=gpxInitializeList(&gpxDataToString, &appendGpxData, &deleteGpxData, &compareGpxData);
         newWaypoint->latitude=latitude;
         newWaypoint->longitude=longitude;
         return newWaypoint;
     }
 }
 
+bool getCoordinates(xmlNode* node, double* latitude, double* longitude){
+    bool hasLatitude=false;
+    bool hasLongitude=false;
+    for(xmlAttr* a = node->properties; a!=NULL; a=a->next){
+        const char* attrName=(const char*)a->name;
+        //"lat" and "lon" differ in their third letter only
+        if (attrName[0]!='l' || attrName[1]=='\0' || attrName[2]=='\0' || attrName[3]!='\0'){
+            continue;
+        }
+        const char* cont=(a->children!=NULL) ? (const char*)a->children->content : NULL;
+        if (attrName[1]=='a' && attrName[2]=='t'){
+            hasLatitude=parseGPXDecimal(cont, latitude);
+        }
+        else if (attrName[1]=='o' && attrName[2]=='n'){
+            hasLongitude=parseGPXDecimal(cont, longitude);
+        }
+    }
+    return hasLatitude && hasLongitude;
+}
+
 Waypoint* makeWaypoint(xmlNode* node){
     char* name= getName(node);
+    if (name==NULL){
+        name="";
+    }
     double lat=0.00;
     double lon=0.00;
-    for(xmlAttr* a = node->properties; a!=NULL; a=a->next){
-        xmlNode *value = a->children;
-        char *attrName = (char *)a->name;
-        char *cont = (char *)(value->content);
-        if(strcmp(attrName, "lat")==0){
-            lat=atof(cont);
-        }
-        if(strcmp(attrName, "lon")==0){
-            lon=atof(cont);
-        }
+    if (getCoordinates(node, &lat, &lon)==false){
+        return NULL;
     }
     Waypoint* newWaypoint= createWaypoint(name, lon, lat);
+    if (newWaypoint==NULL){
+        return NULL;
+    }
     for (xmlNode* child = node->children; child!=NULL; child=child->next){
-        char* name= (char*)child->name;
-        if(strcmp(name, "name")!=0 && isText(child)==false){
-            GPXData* g = makeGPXData(child);
-            insertBack(newWaypoint->otherData, g);
+        if(isElement(child) && isName(child)==false){
+            char* content=(child->children!=NULL) ? (char*)child->children->content : NULL;
+            unsigned int decoded=decodePointField(&newWaypoint->fields, (char*)child->name, content);
+            if (decoded!=0 && buildContext.typedPointData){
+                newWaypoint->fields.textOmitted|=decoded;
+                continue;
+            }
+            if (insertElementData(newWaypoint->otherData, child)==false){
+                if (buildContext.arena==NULL){
+                    deleteWaypoint(newWaypoint);
+                }
+                return NULL;
+            }
         }
     }
     return newWaypoint;
@@ -155,9 +287,9 @@ Route* createRoute(char* name){
         return NULL;
     }
     else{
-        Route* newRoute = calloc(1, sizeof(Route));
-        newRoute->waypoints=initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
-        newRoute->otherData=initializeList(&gpxDataToString, &deleteGpxData, &compareGpxData);
+        Route* newRoute = gpxCalloc(1, sizeof(Route));
+        newRoute->waypoints=gpxInitializeList(&waypointToString, &appendWaypoint, &deleteWaypoint, &compareWaypoints);
+        newRoute->otherData=gpxInitializeList(&gpxDataToString, &appendGpxData, &deleteGpxData, &compareGpxData);
         newRoute->name=stringCopy(name, 0, strlen(name));
         return newRoute;
     }
@@ -165,34 +297,89 @@ Route* createRoute(char* name){
 
 Route* makeRoute(xmlNode* node){
     char* name =getName(node);
+    if (name==NULL){
+        name="";
+    }
     Route* newRoute=createRoute(name);
+    //an invalid <rtept> fails the route, and with it the document, as an invalid <wpt> does
     for(xmlNode* child = node->children; child!=NULL; child=child->next){
+        if (isElement(child)==false){
+            continue;
+        }
+        bool added=true;
         if(strcmp((char*)child->name, "rtept")==0){
             Waypoint* w = makeWaypoint(child);
             insertBack(newRoute->waypoints, w);
+            added=(w!=NULL);
         }
-        else if (isText(child)==false && isName(child)==false){
-            GPXData* g = makeGPXData(child);
-            insertBack(newRoute->otherData, g);
+        else if (isName(child)==false){
+            added=insertElementData(newRoute->otherData, child);
+        }
+        if (added==false){
+            if (buildContext.arena==NULL){
+                deleteRoute(newRoute);
+            }
+            return NULL;
         }
     }
     return newRoute;
 }
 
 TrackSegment* createTrackSegment(void){
-    TrackSegment* newTrackSegment = calloc(1, sizeof(TrackSegment));
-    newTrackSegment->waypoints=initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
+    TrackSegment* newTrackSegment = gpxCalloc(1, sizeof(TrackSegment));
+    newTrackSegment->waypoints=gpxInitializeList(&waypointToString, &appendWaypoint, &deleteWaypoint, &compareWaypoints);
     return newTrackSegment;
 }
 
 TrackSegment* makeTrackSegment(xmlNode* node){
     TrackSegment* t = createTrackSegment();
+    if (buildContext.columnarSegments){
+        SegmentColumns* columns=makeSegmentColumns(node);
+        if (columns==NULL){
+            if (buildContext.arena==NULL){
+                deleteTrackSegment(t);
+            }
+            return NULL;
+        }
+        setSegmentColumns(t, columns);
+        return t;
+    }
+    //the points are gathered first so their nodes can be allocated in one block
+    int count=0;
+    for (xmlNode* child = node->children; child!=NULL; child=child->next){
+        count+=(isElement(child) && strcmp((char*)child->name, "trkpt")==0);
+    }
+    void** points=(count>0) ? malloc(count*sizeof(void*)) : NULL;
+    int numPoints=0;
     for (xmlNode* child = node->children; child!=NULL; child=child->next){
-        if(strcmp((char*)child->name, "trkpt")==0){
+        if(isElement(child) && strcmp((char*)child->name, "trkpt")==0){
             Waypoint* w = makeWaypoint(child);
-            insertBack(t->waypoints, w);
+            //an invalid <trkpt> fails the segment, and with it the document, as an invalid <wpt> does
+            if (w==NULL){
+                if (buildContext.arena==NULL){
+                    for (int i=0; i<numPoints; i++){
+                        deleteWaypoint(points[i]);
+                    }
+                    deleteTrackSegment(t);
+                }
+                free(points);
+                return NULL;
+            }
+            if (points!=NULL){
+                points[numPoints++]=w;
+            }
+            else{
+                insertBack(t->waypoints, w);
+            }
+        }
+    }
+    //out of memory for the block, the points are inserted one node at a time
+    if (points!=NULL && insertBackBatch(t->waypoints, points, numPoints)==false){
+        for (int i=0; i<numPoints; i++){
+            insertBack(t->waypoints, points[i]);
         }
     }
+    free(points);
     return t;
 }
 
@@ -201,24 +388,43 @@ Track* createTrack(char* name){
         return NULL;
     }
     else{
-        Track* newTrack = calloc(1, sizeof(Track));
+        Track* newTrack = gpxCalloc(1, sizeof(Track));
         newTrack->name=stringCopy(name, 0, strlen(name));
-        newTrack->segments=initializeList(&trackSegmentToString, &deleteTrackSegment, &compareTrackSegments);
+        newTrack->segments=gpxInitializeList(&trackSegmentToString, &appendTrackSegment, &deleteTrackSegment, &compareTrackSegments);
+        newTrack->otherData=gpxInitializeList(&gpxDataToString, &appendGpxData, &deleteGpxData, &compareGpxData);
         return newTrack;
     }
 }
 
 Track* makeTrack(xmlNode* node){
     char* name =getName(node);
+    if (name==NULL){
+        name="";
+    }
     Track* t= createTrack(name);
     for (xmlNode* child = node->children; child!=NULL; child=child->next){
+        if (isElement(child)==false){
+            continue;
+        }
+        bool added=true;
         if (strcmp((char*)child->name, "trkseg")==0){
-            TrackSegment* s=makeTrackSegment(child);
+            //addGPXElementsParallel leaves segments it has already built in the node
+            TrackSegment* s=child->_private;
+            child->_private=NULL;
+            if (s==NULL){
+                s=makeTrackSegment(child);
+            }
             insertBack(t->segments, s);
+            added=(s!=NULL);
+        }
+        else if (isName(child)==false){
+            added=insertElementData(t->otherData, child);
         }
-        else if (isText(child)==false && isName(child)==false){
-            GPXData* d=makeGPXData(child);
-            insertBack(t->otherData, d);
+        if (added==false){
+            if (buildContext.arena==NULL){
+                deleteTrack(t);
+            }
+            return NULL;
         }
     }
     return t;
@@ -232,6 +438,10 @@ bool isName(xmlNode* node){
     return false;
 }
 
+bool isElement(xmlNode* node){
+    return node->type==XML_ELEMENT_NODE;
+}
+
 bool isText(xmlNode* node){
     char* text = (char*)node->name;
     if (strcmp(text, "text")==0){
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//One slot of an open-addressing table.  item is NULL for empty slots
+typedef struct {
+    uint32_t hash;
+    void* item;
+} NameSlot;
+
+typedef struct {
+    NameSlot* slots;
+    //always a power of two, at least twice the number of items
+    size_t capacity;
+    //version of the list the table was built from, to notice lists changed behind the index's back
+    unsigned long listVersion;
+    bool built;
+} NameTable;
+
+struct gpxNameIndex{
+    NameTable tables[3];
+};
+
+//FNV-1a
+static uint32_t hashName(const char* name){
+    uint32_t hash=2166136261u;
+    for (const unsigned char* c=(const unsigned char*)name; *c!='\0'; c++){
+        hash^=*c;
+        hash*=16777619u;
+    }
+    return hash;
+}
+
+//Waypoint, Route and Track each keep their name in their own struct
+static char* nameOf(NameKind kind, void* item){
+    switch (kind){
+        case NAME_WAYPOINT:
+            return ((Waypoint*)item)->name;
+        case NAME_ROUTE:
+            return ((Route*)item)->name;
+        default:
+            return ((Track*)item)->name;
+    }
+}
+
+static List* listOf(const GPXdoc* doc, NameKind kind){
+    switch (kind){
+        case NAME_WAYPOINT:
+            return doc->waypoints;
+        case NAME_ROUTE:
+            return doc->routes;
+        default:
+            return doc->tracks;
+    }
+}
+
+static bool buildTable(NameTable* table, List* list, NameKind kind){
+    int length=getLength(list);
+    size_t capacity=16;
+    while (capacity<(size_t)length*2){
+        capacity*=2;
+    }
+    NameSlot* slots=calloc(capacity, sizeof(NameSlot));
+    if (slots==NULL){
+        return false;
+    }
+    free(table->slots);
+    table->slots=slots;
+    table->capacity=capacity;
+    table->listVersion=getListVersion(list);
+    table->built=true;
+
+    ListIterator iter=createIterator(list);
+    void* item;
+    while ((item=nextElement(&iter))!=NULL){
+        char* name=nameOf(kind, item);
+        if (name==NULL){
+            continue;
+        }
+        uint32_t hash=hashName(name);
+        size_t i=hash&(capacity-1);
+        //an item whose name is already in the table is left out, so that the first one wins
+        while (slots[i].item!=NULL){
+            if (slots[i].hash==hash && strcmp(nameOf(kind, slots[i].item), name)==0){
+                break;
+            }
+            i=(i+1)&(capacity-1);
+        }
+        if (slots[i].item==NULL){
+            slots[i].hash=hash;
+            slots[i].item=item;
+        }
+    }
+    return true;
+}
+
+//finds the item by scanning the list, for when the table cannot be allocated
+static void* scanList(List* list, NameKind kind, const char* name){
+    ListIterator iter=createIterator(list);
+    void* item;
+    while ((item=nextElement(&iter))!=NULL){
+        char* itemName=nameOf(kind, item);
+        if (itemName!=NULL && strcmp(itemName, name)==0){
+            return item;
+        }
+    }
+    return NULL;
+}
+
+void* lookupName(const GPXdoc* doc, NameKind kind, const char* name){
+    if (doc==NULL || name==NULL){
+        return NULL;
+    }
+    List* list=listOf(doc, kind);
+    //the index is a cache, so building it does not count as modifying the document
+    GPXdoc* writable=(GPXdoc*)doc;
+    if (writable->nameIndex==NULL){
+        writable->nameIndex=calloc(1, sizeof(struct gpxNameIndex));
+        if (writable->nameIndex==NULL){
+            return scanList(list, kind, name);
+        }
+    }
+    NameTable* table=&writable->nameIndex->tables[kind];
+    if (table->built==false || table->listVersion!=getListVersion(list)){
+        if (buildTable(table, list, kind)==false){
+            return scanList(list, kind, name);
+        }
+    }
+
+    uint32_t hash=hashName(name);
+    size_t i=hash&(table->capacity-1);
+    while (table->slots[i].item!=NULL){
+        NameSlot* slot=&table->slots[i];
+        if (slot->hash==hash){
+            char* itemName=nameOf(kind, slot->item);
+            if (itemName==name || strcmp(itemName, name)==0){
+                return slot->item;
+            }
+        }
+        i=(i+1)&(table->capacity-1);
+    }
+    return NULL;
+}
+
+void invalidateNameIndex(GPXdoc* doc){
+    if (doc==NULL || doc->nameIndex==NULL){
+        return;
+    }
+    for (int i=0; i<3; i++){
+        doc->nameIndex->tables[i].built=false;
+    }
+}
+
+void freeNameIndex(GPXdoc* doc){
+    if (doc==NULL || doc->nameIndex==NULL){
+        return;
+    }
+    for (int i=0; i<3; i++){
+        free(doc->nameIndex->tables[i].slots);
+    }
+    free(doc->nameIndex);
+    doc->nameIndex=NULL;
+}
@@ -0,0 +1,242 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libxml/xmlreader.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+#define FIRST_READ_SIZE (64*1024)
+
+void openMemoryInput(const char* buffer, size_t size, GPXInput* input){
+    memset(input, 0, sizeof(GPXInput));
+    input->buffer=buffer;
+    input->size=size;
+}
+
+//reads everything left in fd, for pipes, sockets and anything else that cannot be mapped
+static bool readAll(int fd, GPXInput* input){
+    size_t capacity=FIRST_READ_SIZE;
+    size_t size=0;
+    char* buffer=malloc(capacity);
+    while (buffer!=NULL){
+        if (size==capacity){
+            char* grown=realloc(buffer, capacity*2);
+            if (grown==NULL){
+                break;
+            }
+            buffer=grown;
+            capacity*=2;
+        }
+        ssize_t count=read(fd, buffer+size, capacity-size);
+        if (count==0){
+            input->buffer=buffer;
+            input->size=size;
+            input->copy=buffer;
+            return true;
+        }
+        if (count<0 && errno!=EINTR){
+            break;
+        }
+        size+=(count>0) ? (size_t)count : 0;
+    }
+    free(buffer);
+    return false;
+}
+
+bool openFdInput(int fd, GPXInput* input){
+    memset(input, 0, sizeof(GPXInput));
+    struct stat info;
+    if (fd<0 || fstat(fd, &info)!=0){
+        return false;
+    }
+    if (S_ISREG(info.st_mode)==false){
+        return readAll(fd, input);
+    }
+    //a regular file is mapped from its current offset, so a descriptor positioned past a header still works
+    off_t offset=lseek(fd, 0, SEEK_CUR);
+    if (offset<0 || offset>=info.st_size){
+        input->buffer="";
+        return true;
+    }
+    //mmap offsets have to be page aligned, so the mapping may start a little before the offset
+    off_t pageStart=offset-offset%sysconf(_SC_PAGESIZE);
+    size_t mappedSize=(size_t)(info.st_size-pageStart);
+    void* mapping=mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, pageStart);
+    if (mapping==MAP_FAILED){
+        return readAll(fd, input);
+    }
+    posix_madvise(mapping, mappedSize, POSIX_MADV_SEQUENTIAL);
+    input->buffer=(const char*)mapping+(offset-pageStart);
+    input->size=(size_t)(info.st_size-offset);
+    input->mapping=mapping;
+    input->mappedSize=mappedSize;
+    return true;
+}
+
+bool openFileInput(const char* fileName, GPXInput* input){
+    int fd=open(fileName, O_RDONLY);
+    if (fd<0){
+        memset(input, 0, sizeof(GPXInput));
+        return false;
+    }
+    //the mapping stays valid once the descriptor is closed
+    bool opened=openFdInput(fd, input);
+    close(fd);
+    input->name=fileName;
+    return opened;
+}
+
+void closeInput(GPXInput* input){
+    if (input->mapping!=NULL){
+        munmap(input->mapping, input->mappedSize);
+    }
+    free(input->copy);
+    memset(input, 0, sizeof(GPXInput));
+}
+
+//The input is handed to libxml2 through read callbacks, which copy it into the parser a few kilobytes
+//at a time.  xmlReadMemory would copy all of it first, and the static buffers of libxml2 2.9 can only be
+//read by the reader, which is also the only way around the int size of a memory buffer
+typedef struct {
+    const char* next;
+    size_t left;
+} MemoryCursor;
+
+static int readMemory(void* context, char* buffer, int length){
+    MemoryCursor* cursor=context;
+    size_t count=((size_t)length<cursor->left) ? (size_t)length : cursor->left;
+    memcpy(buffer, cursor->next, count);
+    cursor->next+=count;
+    cursor->left-=count;
+    return (int)count;
+}
+
+//libxml2 calls this when it is done with the input, including when the parse fails
+static int closeMemory(void* context){
+    free(context);
+    return 0;
+}
+
+static MemoryCursor* createCursor(const GPXInput* input){
+    MemoryCursor* cursor=malloc(sizeof(MemoryCursor));
+    if (cursor!=NULL){
+        cursor->next=input->buffer;
+        cursor->left=input->size;
+    }
+    return cursor;
+}
+
+//sets the callbacks libxml2 reads input through, and returns their context
+static void* openCallbacks(const GPXInput* input, xmlInputReadCallback* read, xmlInputCloseCallback* close){
+    if (getInputCompression(input)!=GPX_COMPRESSION_NONE){
+        *read=&readDecompressed;
+        *close=&closeDecompressed;
+        return openDecompressor(input);
+    }
+    *read=&readMemory;
+    *close=&closeMemory;
+    return createCursor(input);
+}
+
+//As openCallbacks, except that a decompressor is closed by finishInput rather than by libxml2, so a corrupt
+//end of the compressed input still fails the parse.  decompressor is set to it, or NULL for other input
+static void* openInput(const GPXInput* input, xmlInputReadCallback* read, xmlInputCloseCallback* close, void** decompressor){
+    *decompressor=NULL;
+    void* context=openCallbacks(input, read, close);
+    if (context!=NULL && *close==&closeDecompressed){
+        *close=NULL;
+        *decompressor=context;
+    }
+    return context;
+}
+
+bool finishInput(void* decompressor, bool ok){
+    if (decompressor==NULL){
+        return ok;
+    }
+    ok=ok && finishDecompressed(decompressor);
+    closeDecompressed(decompressor);
+    return ok;
+}
+
+xmlDoc* readInputTree(const GPXInput* input){
+    xmlInputReadCallback read;
+    xmlInputCloseCallback close;
+    void* decompressor;
+    void* context=openInput(input, &read, &close, &decompressor);
+    if (context==NULL){
+        return NULL;
+    }
+    xmlDoc* doc=xmlReadIO(read, close, context, input->name, NULL, 0);
+    if (finishInput(decompressor, doc!=NULL)==false && doc!=NULL){
+        xmlFreeDoc(doc);
+        doc=NULL;
+    }
+    return doc;
+}
+
+xmlTextReaderPtr createInputReader(const GPXInput* input, void** decompressor){
+    *decompressor=NULL;
+    if (input->size<=INT_MAX && getInputCompression(input)==GPX_COMPRESSION_NONE){
+        //the reader pushes a memory buffer to its parser in small pieces itself
+        return xmlReaderForMemory(input->buffer, (int)input->size, input->name, NULL, 0);
+    }
+    xmlInputReadCallback read;
+    xmlInputCloseCallback close;
+    void* context=openInput(input, &read, &close, decompressor);
+    if (context==NULL){
+        return NULL;
+    }
+    xmlTextReaderPtr reader=xmlReaderForIO(read, close, context, input->name, NULL, 0);
+    if (reader==NULL){
+        finishInput(*decompressor, false);
+        *decompressor=NULL;
+    }
+    return reader;
+}
+
+xmlParserCtxtPtr createInputParserCtxt(const GPXInput* input, void** decompressor){
+    xmlInputReadCallback read;
+    xmlInputCloseCallback close;
+    void* context=openInput(input, &read, &close, decompressor);
+    if (context==NULL){
+        return NULL;
+    }
+    //libxml2 calls close itself if the context cannot be made
+    xmlParserCtxtPtr ctxt=xmlCreateIOParserCtxt(NULL, NULL, read, close, context, XML_CHAR_ENCODING_NONE);
+    if (ctxt==NULL){
+        finishInput(*decompressor, false);
+        *decompressor=NULL;
+        return NULL;
+    }
+    //the name is what the messages of the parser refer to, as for the other readers
+    if (input->name!=NULL && ctxt->input!=NULL && ctxt->input->filename==NULL){
+        ctxt->input->filename=(char*)xmlStrdup((const xmlChar*)input->name);
+    }
+    return ctxt;
+}
+
+xmlParserInputBufferPtr createInputBuffer(const GPXInput* input, void** decompressor){
+    xmlInputReadCallback read;
+    xmlInputCloseCallback close;
+    void* context=openInput(input, &read, &close, decompressor);
+    if (context==NULL){
+        return NULL;
+    }
+    xmlParserInputBufferPtr buffer=xmlParserInputBufferCreateIO(read, close, context, XML_CHAR_ENCODING_NONE);
+    if (buffer==NULL){
+        if (close!=NULL){
+            close(context);
+        }
+        finishInput(*decompressor, false);
+        *decompressor=NULL;
+    }
+    return buffer;
+}
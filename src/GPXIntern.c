@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//The pool is split into stripes, each a hash table with a lock of its own, so threads building
+//documents side by side rarely wait for each other
+#define NUM_STRIPES 16
+#define FIRST_BUCKETS 16
+
+//One pooled string.  The text handed out is the text member, and release finds the entry from it
+typedef struct internEntry {
+    struct internEntry* next;
+    uint32_t hash;
+    size_t references;
+    char text[];
+} InternEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    InternEntry** buckets;
+    size_t numBuckets;
+    size_t count;
+} InternStripe;
+
+static InternStripe stripes[NUM_STRIPES];
+static pthread_once_t stripesOnce=PTHREAD_ONCE_INIT;
+
+static void initializeStripes(void){
+    for (int i=0; i<NUM_STRIPES; i++){
+        pthread_mutex_init(&stripes[i].lock, NULL);
+    }
+}
+
+//The strings an arena holds one reference to each, however many of its GPXData use them.
+//Open addressing over the pooled pointers, looked up by text so the pool is only locked for new names
+struct internTable {
+    const char** slots;
+    size_t numSlots;
+    size_t count;
+};
+
+//FNV-1a
+static uint32_t hashString(const char* text){
+    uint32_t hash=2166136261u;
+    for (const unsigned char* c=(const unsigned char*)text; *c!='\0'; c++){
+        hash=(hash^*c)*16777619u;
+    }
+    return hash;
+}
+
+static InternEntry* entryOf(const char* text){
+    return (InternEntry*)(text-offsetof(InternEntry, text));
+}
+
+static bool growStripe(InternStripe* stripe){
+    size_t numBuckets=(stripe->numBuckets==0) ? FIRST_BUCKETS : stripe->numBuckets*2;
+    InternEntry** buckets=calloc(numBuckets, sizeof(InternEntry*));
+    if (buckets==NULL){
+        return false;
+    }
+    for (size_t i=0; i<stripe->numBuckets; i++){
+        InternEntry* e=stripe->buckets[i];
+        while (e!=NULL){
+            InternEntry* next=e->next;
+            size_t bucket=e->hash&(numBuckets-1);
+            e->next=buckets[bucket];
+            buckets[bucket]=e;
+            e=next;
+        }
+    }
+    free(stripe->buckets);
+    stripe->buckets=buckets;
+    stripe->numBuckets=numBuckets;
+    return true;
+}
+
+static const char* internHashed(const char* text, uint32_t hash){
+    pthread_once(&stripesOnce, &initializeStripes);
+    //the top bits pick the stripe, the bottom bits the bucket within it
+    InternStripe* stripe=&stripes[hash>>28];
+    pthread_mutex_lock(&stripe->lock);
+    if (stripe->count>=stripe->numBuckets && growStripe(stripe)==false && stripe->numBuckets==0){
+        pthread_mutex_unlock(&stripe->lock);
+        return NULL;
+    }
+    size_t bucket=hash&(stripe->numBuckets-1);
+    InternEntry* e=stripe->buckets[bucket];
+    while (e!=NULL && (e->hash!=hash || strcmp(e->text, text)!=0)){
+        e=e->next;
+    }
+    if (e==NULL){
+        size_t length=strlen(text);
+        e=malloc(sizeof(InternEntry)+length+1);
+        if (e==NULL){
+            pthread_mutex_unlock(&stripe->lock);
+            return NULL;
+        }
+        memcpy(e->text, text, length+1);
+        e->hash=hash;
+        e->references=0;
+        e->next=stripe->buckets[bucket];
+        stripe->buckets[bucket]=e;
+        stripe->count++;
+    }
+    e->references++;
+    pthread_mutex_unlock(&stripe->lock);
+    return e->text;
+}
+
+const char* internString(const char* text){
+    if (text==NULL){
+        return NULL;
+    }
+    return internHashed(text, hashString(text));
+}
+
+void releaseString(const char* text){
+    if (text==NULL){
+        return;
+    }
+    //text may not be from the pool, e.g. the name of a GPXData built by hand, so its entry is looked up by
+    //address rather than worked out from it
+    uint32_t hash=hashString(text);
+    pthread_once(&stripesOnce, &initializeStripes);
+    InternStripe* stripe=&stripes[hash>>28];
+    pthread_mutex_lock(&stripe->lock);
+    InternEntry** link=(stripe->numBuckets>0) ? &stripe->buckets[hash&(stripe->numBuckets-1)] : NULL;
+    while (link!=NULL && *link!=NULL && (*link)->text!=text){
+        link=&(*link)->next;
+    }
+    if (link!=NULL && *link!=NULL){
+        InternEntry* entry=*link;
+        if (--entry->references==0){
+            *link=entry->next;
+            stripe->count--;
+            free(entry);
+        }
+    }
+    pthread_mutex_unlock(&stripe->lock);
+}
+
+//returns the slot of text in table, or the empty slot it would go in
+static const char** findSlot(struct internTable* table, const char* text, uint32_t hash){
+    size_t mask=table->numSlots-1;
+    for (size_t i=hash&mask; ; i=(i+1)&mask){
+        if (table->slots[i]==NULL || strcmp(table->slots[i], text)==0){
+            return &table->slots[i];
+        }
+    }
+}
+
+static bool growTable(struct internTable* table){
+    size_t numSlots=(table->numSlots==0) ? FIRST_BUCKETS : table->numSlots*2;
+    struct internTable grown={calloc(numSlots, sizeof(char*)), numSlots, table->count};
+    if (grown.slots==NULL){
+        return false;
+    }
+    for (size_t i=0; i<table->numSlots; i++){
+        if (table->slots[i]!=NULL){
+            *findSlot(&grown, table->slots[i], entryOf(table->slots[i])->hash)=table->slots[i];
+        }
+    }
+    free(table->slots);
+    *table=grown;
+    return true;
+}
+
+//adds pooled, whose reference the table takes over, unless the table holds it already
+static bool addToTable(struct internTable* table, const char* pooled){
+    //kept at most half full
+    if (2*(table->count+1)>table->numSlots && growTable(table)==false){
+        return false;
+    }
+    const char** slot=findSlot(table, pooled, entryOf(pooled)->hash);
+    if (*slot!=NULL){
+        releaseString(pooled);
+        return true;
+    }
+    *slot=pooled;
+    table->count++;
+    return true;
+}
+
+const char* internArenaString(GPXArena* arena, const char* text){
+    if (arena==NULL){
+        return internString(text);
+    }
+    if (text==NULL){
+        return NULL;
+    }
+    if (arena->names==NULL){
+        arena->names=calloc(1, sizeof(struct internTable));
+        if (arena->names==NULL){
+            return NULL;
+        }
+    }
+    uint32_t hash=hashString(text);
+    if (arena->names->numSlots>0){
+        const char** slot=findSlot(arena->names, text, hash);
+        if (*slot!=NULL){
+            return *slot;
+        }
+    }
+    const char* pooled=internHashed(text, hash);
+    if (pooled==NULL || addToTable(arena->names, pooled)==false){
+        releaseString(pooled);
+        return NULL;
+    }
+    return pooled;
+}
+
+void releaseArenaStrings(GPXArena* arena){
+    struct internTable* table=arena->names;
+    if (table==NULL){
+        return;
+    }
+    for (size_t i=0; i<table->numSlots; i++){
+        releaseString(table->slots[i]);
+    }
+    free(table->slots);
+    free(table);
+    arena->names=NULL;
+}
+
+void adoptArenaStrings(GPXArena* parent, GPXArena* child){
+    struct internTable* table=child->names;
+    if (table==NULL){
+        return;
+    }
+    for (size_t i=0; i<table->numSlots; i++){
+        if (table->slots[i]==NULL){
+            continue;
+        }
+        if (parent->names==NULL){
+            parent->names=calloc(1, sizeof(struct internTable));
+        }
+        //Out of memory, the reference is kept rather than released, since the document still uses the
+        //string.  It is never given back to the pool, which is the lesser harm
+        if (parent->names!=NULL){
+            addToTable(parent->names, table->slots[i]);
+        }
+    }
+    free(table->slots);
+    free(table);
+    child->names=NULL;
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//The elements built by one parallel pass, and the build context each worker runs with
+typedef struct {
+    xmlNode** nodes;
+    void** built;
+    GPXBuildContext* contexts;
+} ElementJob;
+
+static void* buildElement(xmlNode* node){
+    char* name=(char*)node->name;
+    if (strcmp(name, "wpt")==0){
+        return makeWaypoint(node);
+    }
+    else if (strcmp(name, "rte")==0){
+        return makeRoute(node);
+    }
+    else if (strcmp(name, "trk")==0){
+        return makeTrack(node);
+    }
+    return makeTrackSegment(node);
+}
+
+static void buildTask(void* context, int index, int worker){
+    ElementJob* job=context;
+    GPXBuildContext* build=getBuildContext();
+    GPXBuildContext saved=*build;
+    *build=job->contexts[worker];
+    job->built[index]=buildElement(job->nodes[index]);
+    *build=saved;
+}
+
+static bool isTopLevel(xmlNode* node){
+    char* name=(char*)node->name;
+    return isElement(node) && (strcmp(name, "wpt")==0 || strcmp(name, "rte")==0 || strcmp(name, "trk")==0);
+}
+
+//frees the elements of a failed build; in an arena they go with the arena
+static void discardElements(xmlNode** nodes, void** built, int count){
+    if (getBuildContext()->arena!=NULL){
+        return;
+    }
+    for (int i=0; i<count; i++){
+        if (built[i]==NULL){
+            continue;
+        }
+        char* name=(char*)nodes[i]->name;
+        if (strcmp(name, "wpt")==0){
+            deleteWaypoint(built[i]);
+        }
+        else if (strcmp(name, "rte")==0){
+            deleteRoute(built[i]);
+        }
+        else{
+            deleteTrack(built[i]);
+        }
+    }
+}
+
+bool addGPXElementsParallel(GPXdoc* doc, xmlNode* root){
+    GPXBuildContext* context=getBuildContext();
+    int numThreads=context->numThreads;
+
+    //the top-level elements, followed by the segments of every track
+    int numElements=0;
+    int numSegments=0;
+    for (xmlNode* child=root->children; child!=NULL; child=child->next){
+        if (isTopLevel(child)){
+            numElements++;
+            if (strcmp((char*)child->name, "trk")==0){
+                for (xmlNode* s=child->children; s!=NULL; s=s->next){
+                    numSegments+=(isElement(s) && strcmp((char*)s->name, "trkseg")==0);
+                }
+            }
+        }
+    }
+    int numNodes=numElements+numSegments;
+    xmlNode** nodes=malloc(sizeof(xmlNode*)*(numNodes+1));
+    void** built=calloc(numNodes+1, sizeof(void*));
+    GPXBuildContext* contexts=calloc(numThreads, sizeof(GPXBuildContext));
+    ElementJob job;
+    job.contexts=contexts;
+    bool success=(nodes!=NULL && built!=NULL && contexts!=NULL);
+    bool listed=success;
+
+    int next=0;
+    for (xmlNode* child=root->children; success && child!=NULL; child=child->next){
+        if (isTopLevel(child)){
+            nodes[next++]=child;
+        }
+    }
+    for (int i=0; success && i<numElements; i++){
+        if (strcmp((char*)nodes[i]->name, "trk")==0){
+            for (xmlNode* s=nodes[i]->children; s!=NULL; s=s->next){
+                if (isElement(s) && strcmp((char*)s->name, "trkseg")==0){
+                    nodes[next++]=s;
+                }
+            }
+        }
+    }
+
+    //every worker gets a copy of the context, with an arena of its own if the document uses one
+    for (int i=0; success && i<numThreads; i++){
+        contexts[i]=*context;
+        contexts[i].numThreads=1;
+        if (context->arena!=NULL){
+            contexts[i].arena=createChildArena(context->arena);
+            success=(contexts[i].arena!=NULL);
+        }
+    }
+
+    //Segments are built first, so that a giant track is spread over the threads as well.  makeTrack
+    //picks each one up from the _private field of its node, and builds any that are missing itself
+    if (success){
+        job.nodes=nodes+numElements;
+        job.built=built+numElements;
+        success=runParallel(numThreads, numSegments, &buildTask, &job);
+    }
+    for (int i=0; success && i<numSegments; i++){
+        nodes[numElements+i]->_private=built[numElements+i];
+    }
+    if (success){
+        job.nodes=nodes;
+        job.built=built;
+        success=runParallel(numThreads, numElements, &buildTask, &job);
+    }
+    //segments whose track was never built
+    for (int i=0; listed && i<numSegments; i++){
+        xmlNode* segment=nodes[numElements+i];
+        if (segment->_private!=NULL && context->arena==NULL){
+            deleteTrackSegment(segment->_private);
+        }
+        segment->_private=NULL;
+    }
+    for (int i=0; success && i<numElements; i++){
+        success=(built[i]!=NULL);
+    }
+
+    if (context->arena!=NULL && contexts!=NULL){
+        for (int i=0; i<numThreads; i++){
+            adoptChildArena(context->arena, contexts[i].arena);
+        }
+    }
+    if (success){
+        //spliced in document order, exactly as addGPXElement would have appended them
+        for (int i=0; i<numElements; i++){
+            char* name=(char*)nodes[i]->name;
+            NameKind kind=NAME_TRACK;
+            if (strcmp(name, "wpt")==0){
+                insertBack(doc->waypoints, built[i]);
+                kind=NAME_WAYPOINT;
+            }
+            else if (strcmp(name, "rte")==0){
+                insertBack(doc->routes, built[i]);
+                kind=NAME_ROUTE;
+            }
+            else{
+                insertBack(doc->tracks, built[i]);
+            }
+            addElementCounts(doc, kind, built[i]);
+        }
+    }
+    else if (listed){
+        discardElements(nodes, built, numElements);
+    }
+    free(nodes);
+    free(built);
+    free(contexts);
+    return success;
+}
@@ -11,48 +11,177 @@
 #include "GPXHelpers.h"
 
 
-GPXdoc* createGPXdoc(char* filename){
+//builds the document from the whole XML tree of the input
+static GPXdoc* readGPXTree(const GPXInput* input){
     xmlDoc *doc = NULL;
     xmlNode *root_element = NULL;
-    doc = xmlReadFile(filename, NULL, 0);
+    doc = readInputTree(input);
 
     if (doc == NULL) {
-        printf("error: could not parse file %s\n", filename);
+        printf("error: could not parse file %s\n", (input->name!=NULL) ? input->name : "from memory");
+        return NULL;
+    }
+
+    xmlSchemaPtr schema=getBuildContext()->schema;
+    if (schema!=NULL && validateXmlDoc(doc, schema)==false){
+        xmlFreeDoc(doc);
+        return NULL;
     }
-    GPXdoc* gpxdoc= calloc(1, sizeof(GPXdoc));
-    gpxdoc->creator = calloc(256, sizeof(char));
-    gpxdoc->routes = initializeList(&routeToString, &deleteRoute, &compareRoutes);
-    gpxdoc->tracks = initializeList(&trackToString, &deleteTrack, &compareTracks);
-    gpxdoc->waypoints = initializeList(&waypointToString, &deleteWaypoint, &compareWaypoints);
 
     root_element = xmlDocGetRootElement(doc);
+    if (root_element==NULL || strcmp((char*)root_element->name, "gpx")!=0){
+        xmlFreeDoc(doc);
+        return NULL;
+    }
 
-    for (xmlNode* child = root_element->children; child!=NULL; child=child->next){
-        char*name = (char*)child->name;
-        if (strcmp(name, "rte")==0){
-            Route* r = makeRoute(child);
-            insertBack(gpxdoc->routes, r);
-        }
-        if (strcmp(name, "trk")==0){
-            Track* t = makeTrack(child);
-            insertBack(gpxdoc->tracks, t);
+    //get creator, version, namespace
+    char* namespace = NULL;
+    if (root_element->ns!=NULL){
+        namespace=(char*)root_element->ns->href;
+    }
+    GPXdoc* gpxdoc = createEmptyGPXdoc(namespace, getAttribute(root_element, "version"), getAttribute(root_element, "creator"));
+    if (gpxdoc==NULL){
+        xmlFreeDoc(doc);
+        return NULL;
+    }
+
+    if (getBuildContext()->numThreads>1){
+        if (addGPXElementsParallel(gpxdoc, root_element)==false){
+            discardGPXdoc(gpxdoc);
+            gpxdoc=NULL;
         }
-        if (strcmp(name, "wpt")==0){
-            Waypoint* w = makeWaypoint(child);
-            insertBack(gpxdoc->waypoints, w);
+    }
+    else{
+        for (xmlNode* child = root_element->children; child!=NULL; child=child->next){
+            if (isElement(child) && addGPXElement(gpxdoc, child)==false){
+                discardGPXdoc(gpxdoc);
+                gpxdoc=NULL;
+                break;
+            }
         }
     }
-    //get creator, version, namespace
+    xmlFreeDoc(doc);
     return gpxdoc;
 }
 
-/** Function to create a string representation of an GPX object.
- *@pre GPX object exists, is not null, and is valid
- *@post GPX has not been modified in any way, and a string representing the GPX contents has been created
- *@return a string contaning a humanly readable representation of an GPX object
- *@param obj - a pointer to an GPX struct
-**/
-char* GPXdocToString(GPXdoc* doc);
+GPXdoc* createGPXdoc(char* fileName){
+    return createGPXdocWithOptions(fileName, NULL);
+}
+
+GPXdoc* createGPXdocStreaming(char* fileName){
+    GPXParseOptions options;
+    memset(&options, 0, sizeof(GPXParseOptions));
+    options.streaming=true;
+    return createGPXdocWithOptions(fileName, &options);
+}
+
+//builds the document from input with options, which may be NULL
+static GPXdoc* readGPXInput(const GPXInput* input, const GPXParseOptions* options){
+    GPXParseOptions defaults;
+    memset(&defaults, 0, sizeof(GPXParseOptions));
+    if (options==NULL){
+        options=&defaults;
+    }
+
+    //the constructors pick their allocator up from the build context, so it is set for the whole parse
+    GPXBuildContext* context=getBuildContext();
+    GPXBuildContext saved=*context;
+    memset(context, 0, sizeof(GPXBuildContext));
+    context->columnarSegments=options->columnarSegments;
+    context->typedPointData=options->typedPointData;
+    context->listStorage=options->unrolledLists ? LIST_UNROLLED : LIST_LINKED;
+    context->numThreads=(options->numThreads<0) ? getProcessorCount() : options->numThreads;
+    if (options->schemaFile!=NULL){
+        context->schema=getCompiledSchema(options->schemaFile);
+        //the reader cannot validate an element it has skipped with xmlTextReaderNext, so streamed input is checked first
+        if (context->schema==NULL || (options->streaming && validateInput(input, context->schema)==false)){
+            *context=saved;
+            return NULL;
+        }
+    }
+    if (options->useArena){
+        context->arena=createArena();
+        if (context->arena==NULL){
+            *context=saved;
+            return NULL;
+        }
+    }
+
+    GPXdoc* doc=NULL;
+    if (options->streaming){
+        doc=readGPXStream(input);
+    }
+    else{
+        doc=readGPXTree(input);
+    }
+
+    if (doc==NULL && context->arena!=NULL){
+        destroyArena(context->arena);
+    }
+    *context=saved;
+    return doc;
+}
+
+GPXdoc* createGPXdocWithOptions(char* fileName, const GPXParseOptions* options){
+    if (fileName==NULL || strcmp(fileName, "")==0){
+        return NULL;
+    }
+    //the file is mapped and parsed in place rather than read through stdio
+    GPXInput input;
+    if (openFileInput(fileName, &input)==false){
+        return NULL;
+    }
+    GPXdoc* doc=readGPXInput(&input, options);
+    closeInput(&input);
+    return doc;
+}
+
+GPXdoc* createGPXdocFromMemory(const char* buffer, size_t size){
+    return createGPXdocFromMemoryWithOptions(buffer, size, NULL);
+}
+
+GPXdoc* createGPXdocFromMemoryWithOptions(const char* buffer, size_t size, const GPXParseOptions* options){
+    if (buffer==NULL){
+        return NULL;
+    }
+    GPXInput input;
+    openMemoryInput(buffer, size, &input);
+    return readGPXInput(&input, options);
+}
+
+GPXdoc* createGPXdocFromFd(int fd){
+    return createGPXdocFromFdWithOptions(fd, NULL);
+}
+
+GPXdoc* createGPXdocFromFdWithOptions(int fd, const GPXParseOptions* options){
+    GPXInput input;
+    if (openFdInput(fd, &input)==false){
+        return NULL;
+    }
+    GPXdoc* doc=readGPXInput(&input, options);
+    closeInput(&input);
+    return doc;
+}
+
+char* GPXdocToString(GPXdoc* doc){
+    if (doc==NULL){
+        return NULL;
+    }
+    StringBuilder builder;
+    initializeStringBuilder(&builder);
+    appendGPXdoc(&builder, doc);
+    return finishStringBuilder(&builder);
+}
+
+void appendGPXdoc(StringBuilder* builder, const GPXdoc* doc){
+    if (builder==NULL || doc==NULL){
+        return;
+    }
+    appendFormat(builder, "GPX document: version %g, creator %s, namespace %s\n", doc->version, doc->creator, doc->namespace);
+    appendListToString(doc->waypoints, builder);
+    appendListToString(doc->routes, builder);
+    appendListToString(doc->tracks, builder);
+}
 
 /** Function to delete doc content and free all the memory.
  *@pre GPX object exists, is not null, and has not been freed
@@ -64,6 +193,14 @@ void deleteGPXdoc(GPXdoc* doc){
     if (doc==NULL){
         return;
     }
+    freeNameIndex(doc);
+    freeSummaries(doc);
+    //everything in an arena document is released with the arena
+    GPXArena* arena=getListArena(doc->waypoints);
+    if (arena!=NULL){
+        destroyArena(arena);
+        return;
+    }
     GPXdoc* temp= (GPXdoc*)doc;
     free(temp->creator);
     freeList(temp->routes);
@@ -83,44 +220,274 @@ They all share the same format and only differ in what they have to count.
 
 
 //Total number of waypoints in the GPX file
-int getNumWaypoints(const GPXdoc* doc);
+int getNumWaypoints(const GPXdoc* doc){
+    return (doc!=NULL) ? getLength(doc->waypoints) : 0;
+}
 
 //Total number of routes in the GPX file
-int getNumRoutes(const GPXdoc* doc);
+int getNumRoutes(const GPXdoc* doc){
+    return (doc!=NULL) ? getLength(doc->routes) : 0;
+}
 
 //Total number of tracks in the GPX file
-int getNumTracks(const GPXdoc* doc);
+int getNumTracks(const GPXdoc* doc){
+    return (doc!=NULL) ? getLength(doc->tracks) : 0;
+}
 
 //Total number of segments in all tracks in the document
-int getNumSegments(const GPXdoc* doc);
+int getNumSegments(const GPXdoc* doc){
+    if (doc==NULL){
+        return 0;
+    }
+    updateGPXCounts(doc);
+    return doc->numSegments;
+}
 
 //Total number of GPXData elements in the document
-int getNumGPXData(const GPXdoc* doc);
+int getNumGPXData(const GPXdoc* doc){
+    if (doc==NULL){
+        return 0;
+    }
+    updateGPXCounts(doc);
+    return doc->numGPXData;
+}
 
 // Function that returns a waypoint with the given name.  If more than one exists, return the first one.  
 // Return NULL if the waypoint does not exist
-Waypoint* getWaypoint(const GPXdoc* doc, char* name);
+Waypoint* getWaypoint(const GPXdoc* doc, char* name){
+    return (Waypoint*)lookupName(doc, NAME_WAYPOINT, name);
+}
 // Function that returns a track with the given name.  If more than one exists, return the first one. 
 // Return NULL if the track does not exist 
-Track* getTrack(const GPXdoc* doc, char* name);
+Track* getTrack(const GPXdoc* doc, char* name){
+    return (Track*)lookupName(doc, NAME_TRACK, name);
+}
 // Function that returns a route with the given name.  If more than one exists, return the first one.  
 // Return NULL if the route does not exist
-Route* getRoute(const GPXdoc* doc, char* name);
+Route* getRoute(const GPXdoc* doc, char* name){
+    return (Route*)lookupName(doc, NAME_ROUTE, name);
+}
+
+//The lists of an arena document do not delete their data, so an element the caller made and put in one is
+//handed to the arena, which deletes it with the document.  Returns false if there is no memory to do so
+static bool adoptElement(List* list, void* element, void (*deleteElement)(void* data)){
+    GPXArena* arena=getListArena(list);
+    if (arena==NULL || arenaContains(arena, element)){
+        return true;
+    }
+    return adoptArenaElement(arena, element, deleteElement);
+}
+
+//gives an element taken out of list back to the caller, if the arena of the list had adopted it
+static void releaseElement(List* list, void* element){
+    GPXArena* arena=getListArena(list);
+    if (arena!=NULL){
+        releaseArenaElement(arena, element);
+    }
+}
+
+void addWaypoint(GPXdoc* doc, Waypoint* wpt){
+    if (doc==NULL || wpt==NULL){
+        return;
+    }
+    updateGPXCounts(doc);
+    if (adoptElement(doc->waypoints, wpt, &deleteWaypoint)==false){
+        return;
+    }
+    insertBack(doc->waypoints, wpt);
+    addElementCounts(doc, NAME_WAYPOINT, wpt);
+    invalidateNameIndex(doc);
+    invalidateGPXdocSummary(doc);
+}
+
+void addRoute(GPXdoc* doc, Route* rt){
+    if (doc==NULL || rt==NULL){
+        return;
+    }
+    updateGPXCounts(doc);
+    if (adoptElement(doc->routes, rt, &deleteRoute)==false){
+        return;
+    }
+    insertBack(doc->routes, rt);
+    addElementCounts(doc, NAME_ROUTE, rt);
+    invalidateNameIndex(doc);
+    invalidateRouteSummary(doc, NULL);
+}
+
+void addTrack(GPXdoc* doc, Track* tr){
+    if (doc==NULL || tr==NULL){
+        return;
+    }
+    updateGPXCounts(doc);
+    if (adoptElement(doc->tracks, tr, &deleteTrack)==false){
+        return;
+    }
+    insertBack(doc->tracks, tr);
+    addElementCounts(doc, NAME_TRACK, tr);
+    invalidateNameIndex(doc);
+    invalidateTrackSummary(doc, NULL);
+}
+
+bool removeWaypoint(GPXdoc* doc, Waypoint* wpt){
+    if (doc==NULL || wpt==NULL){
+        return false;
+    }
+    updateGPXCounts(doc);
+    if (removeFromList(doc->waypoints, wpt)==false){
+        return false;
+    }
+    releaseElement(doc->waypoints, wpt);
+    removeElementCounts(doc, NAME_WAYPOINT, wpt);
+    invalidateNameIndex(doc);
+    invalidateGPXdocSummary(doc);
+    return true;
+}
+
+bool removeRoute(GPXdoc* doc, Route* rt){
+    if (doc==NULL || rt==NULL){
+        return false;
+    }
+    updateGPXCounts(doc);
+    if (removeFromList(doc->routes, rt)==false){
+        return false;
+    }
+    releaseElement(doc->routes, rt);
+    removeElementCounts(doc, NAME_ROUTE, rt);
+    invalidateNameIndex(doc);
+    invalidateRouteSummary(doc, rt);
+    return true;
+}
+
+bool removeTrack(GPXdoc* doc, Track* tr){
+    if (doc==NULL || tr==NULL){
+        return false;
+    }
+    updateGPXCounts(doc);
+    if (removeFromList(doc->tracks, tr)==false){
+        return false;
+    }
+    releaseElement(doc->tracks, tr);
+    removeElementCounts(doc, NAME_TRACK, tr);
+    invalidateNameIndex(doc);
+    invalidateTrackSummary(doc, tr);
+    return true;
+}
+
+void addTrackSegment(GPXdoc* doc, Track* tr, TrackSegment* seg){
+    if (doc==NULL || tr==NULL || seg==NULL){
+        return;
+    }
+    updateGPXCounts(doc);
+    if (adoptElement(tr->segments, seg, &deleteTrackSegment)==false){
+        return;
+    }
+    insertBack(tr->segments, seg);
+    doc->numSegments++;
+    doc->numGPXData+=countSegmentGPXData(seg);
+    invalidateTrackSummary(doc, tr);
+}
+
+bool removeTrackSegment(GPXdoc* doc, Track* tr, TrackSegment* seg){
+    if (doc==NULL || tr==NULL || seg==NULL){
+        return false;
+    }
+    updateGPXCounts(doc);
+    if (removeFromList(tr->segments, seg)==false){
+        return false;
+    }
+    releaseElement(tr->segments, seg);
+    doc->numSegments--;
+    doc->numGPXData-=countSegmentGPXData(seg);
+    invalidateTrackSummary(doc, tr);
+    return true;
+}
+
+void addGPXData(GPXdoc* doc, List* otherData, GPXData* data){
+    if (doc==NULL || otherData==NULL || data==NULL){
+        return;
+    }
+    updateGPXCounts(doc);
+    if (adoptElement(otherData, data, &deleteGpxData)==false){
+        return;
+    }
+    insertBack(otherData, data);
+    doc->numGPXData++;
+}
+
+bool removeGPXData(GPXdoc* doc, List* otherData, GPXData* data){
+    if (doc==NULL || otherData==NULL || data==NULL){
+        return false;
+    }
+    updateGPXCounts(doc);
+    if (removeFromList(otherData, data)==false){
+        return false;
+    }
+    releaseElement(otherData, data);
+    doc->numGPXData--;
+    return true;
+}
 
 //---------HELPER FUNCTIONS---------
 
+//the *ToString functions are their append* counterparts writing into a builder of their own
+static char* buildString(void (*append)(StringBuilder* builder, void* data), void* data){
+    if (data==NULL){
+        return NULL;
+    }
+    StringBuilder builder;
+    initializeStringBuilder(&builder);
+    append(&builder, data);
+    return finishStringBuilder(&builder);
+}
+
 void deleteGpxData( void* data){
     if (data==NULL){
         return;
     }
     GPXData* temp = (GPXData*)data;
+    releaseString(temp->name);
     free(temp);
 }
 char* gpxDataToString( void* data){
-    return NULL;
+    return buildString(&appendGpxData, data);
+}
+void appendGpxData(StringBuilder* builder, void* data){
+    if (data==NULL){
+        return;
+    }
+    GPXData* temp=(GPXData*)data;
+    appendFormat(builder, "%s: %s\n", temp->name, temp->value);
+}
+//-1, 0 or 1 as first is less than, equal to or greater than second
+static int compareNumbers(double first, double second){
+    return (first>second)-(first<second);
 }
+
+//Orders names with strcmp.  A NULL name, which only a malformed struct has, goes first
+static int compareNames(const char* first, const char* second){
+    if (first==second){
+        return 0;
+    }
+    if (first==NULL || second==NULL){
+        return (first==NULL) ? -1 : 1;
+    }
+    return strcmp(first, second);
+}
+
+//Points without a time go after the ones with a time
+static int compareTimes(int64_t first, int64_t second){
+    if (first==GPX_NO_TIME || second==GPX_NO_TIME){
+        return (first==GPX_NO_TIME)-(second==GPX_NO_TIME);
+    }
+    return (first>second)-(first<second);
+}
+
 int compareGpxData(const void *first, const void *second){
-    return -1;
+    const GPXData* a=first;
+    const GPXData* b=second;
+    //names are interned, so equal names are usually the same pointer
+    int order=compareNames(a->name, b->name);
+    return (order!=0) ? order : strcmp(a->value, b->value);
 }
 
 void deleteWaypoint(void* data){
@@ -133,10 +500,36 @@ void deleteWaypoint(void* data){
     free(temp);
 }
 char* waypointToString( void* data){
-    return NULL;
+    return buildString(&appendWaypoint, data);
+}
+void appendWaypoint(StringBuilder* builder, void* data){
+    if (data==NULL){
+        return;
+    }
+    Waypoint* temp=(Waypoint*)data;
+    appendFormat(builder, "Waypoint %s: latitude %.7f, longitude %.7f\n", temp->name, temp->latitude, temp->longitude);
+    appendListToString(temp->otherData, builder);
+    //fields that are only kept typed are printed the way their GPXData would be
+    GPXFieldText texts[GPX_NUM_POINT_FIELDS];
+    int numTexts=getOmittedPointData(temp, texts);
+    for (int i=0; i<numTexts; i++){
+        appendFormat(builder, "%s: %s\n", texts[i].name, texts[i].value);
+    }
 }
 int compareWaypoints(const void *first, const void *second){
-    return -1;
+    const Waypoint* a=first;
+    const Waypoint* b=second;
+    int order=compareNames(a->name, b->name);
+    if (order==0){
+        order=compareNumbers(a->latitude, b->latitude);
+    }
+    return (order!=0) ? order : compareNumbers(a->longitude, b->longitude);
+}
+
+int compareWaypointsByTime(const void *first, const void *second){
+    const Waypoint* a=first;
+    const Waypoint* b=second;
+    return compareTimes(getPointTime(a), getPointTime(b));
 }
 
 void deleteRoute(void* data){
@@ -150,10 +543,22 @@ void deleteRoute(void* data){
     free(temp);
 }
 char* routeToString(void* data){
-    return NULL;
+    return buildString(&appendRoute, data);
+}
+void appendRoute(StringBuilder* builder, void* data){
+    if (data==NULL){
+        return;
+    }
+    Route* temp=(Route*)data;
+    appendFormat(builder, "Route %s: %d waypoints\n", temp->name, getLength(temp->waypoints));
+    appendListToString(temp->otherData, builder);
+    appendListToString(temp->waypoints, builder);
 }
 int compareRoutes(const void *first, const void *second){
-    return -1;
+    const Route* a=first;
+    const Route* b=second;
+    int order=compareNames(a->name, b->name);
+    return (order!=0) ? order : getLength(a->waypoints)-getLength(b->waypoints);
 }
 
 void deleteTrackSegment(void* data){
@@ -162,14 +567,53 @@ void deleteTrackSegment(void* data){
     }
     TrackSegment* temp=(TrackSegment*)data;
     freeList(temp->waypoints);
+    freeSegmentColumns(temp);
     free(temp);
 }
 char* trackSegmentToString(void* data){
-    return NULL;
+    return buildString(&appendTrackSegment, data);
+}
+void appendTrackSegment(StringBuilder* builder, void* data){
+    if (data==NULL){
+        return;
+    }
+    TrackSegment* temp=(TrackSegment*)data;
+    SegmentColumns* columns=temp->columns;
+    if (isColumnarSegment(temp)==false){
+        appendFormat(builder, "Track segment: %d points\n", getLength(temp->waypoints));
+        appendListToString(temp->waypoints, builder);
+        return;
+    }
+    //points of columnar segments only have their coordinates, <ele> and <time>
+    appendFormat(builder, "Track segment: %d points\n", columns->length);
+    for (int i=0; i<columns->length; i++){
+        appendFormat(builder, "Point: latitude %.7f, longitude %.7f\n", columns->latitude[i], columns->longitude[i]);
+        if (columns->elevation!=NULL && isnan(columns->elevation[i])==false){
+            appendFormat(builder, "ele: %g\n", columns->elevation[i]);
+        }
+        char time[32];
+        if (columns->time!=NULL && formatGPXTime(columns->time[i], time, sizeof(time))){
+            appendFormat(builder, "time: %s\n", time);
+        }
+    }
+}
+//Time of the first point of a segment, GPX_NO_TIME if it has none
+static int64_t getSegmentStart(const TrackSegment* segment){
+    if (isColumnarSegment(segment)){
+        const SegmentColumns* columns=segment->columns;
+        return (columns->length>0 && columns->time!=NULL) ? columns->time[0] : GPX_NO_TIME;
+    }
+    if (getLength(segment->waypoints)==0){
+        return GPX_NO_TIME;
+    }
+    return getPointTime(getFromFront(segment->waypoints));
 }
-int compareTrackSegments(const void *first, const void *second){
-    return -1;
 
+int compareTrackSegments(const void *first, const void *second){
+    const TrackSegment* a=first;
+    const TrackSegment* b=second;
+    int order=compareTimes(getSegmentStart(a), getSegmentStart(b));
+    return (order!=0) ? order : getSegmentNumPoints(a)-getSegmentNumPoints(b);
 }
 
 void deleteTrack(void* data){
@@ -183,8 +627,20 @@ void deleteTrack(void* data){
     free(temp);
 }
 char* trackToString(void* data){
-    return NULL;
+    return buildString(&appendTrack, data);
+}
+void appendTrack(StringBuilder* builder, void* data){
+    if (data==NULL){
+        return;
+    }
+    Track* temp=(Track*)data;
+    appendFormat(builder, "Track %s: %d segments\n", temp->name, getLength(temp->segments));
+    appendListToString(temp->otherData, builder);
+    appendListToString(temp->segments, builder);
 }
 int compareTracks(const void *first, const void *second){
-    return -1;
+    const Track* a=first;
+    const Track* b=second;
+    int order=compareNames(a->name, b->name);
+    return (order!=0) ? order : getLength(a->segments)-getLength(b->segments);
 }
\ No newline at end of file
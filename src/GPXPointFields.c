@@ -0,0 +1,279 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <pthread.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//powers of ten that are exact doubles
+static const double powersOfTen[]={1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+//every integer below this is an exact double
+#define EXACT_MANTISSA (1ULL<<53)
+
+static bool isSpace(char c){
+    return c==' ' || c=='\t' || c=='\n' || c=='\r';
+}
+
+//The "C" locale, made once and used by every thread
+static locale_t cLocale=(locale_t)0;
+static pthread_once_t cLocaleOnce=PTHREAD_ONCE_INIT;
+
+static void createCLocale(void){
+    cLocale=newlocale(LC_ALL_MASK, "C", (locale_t)0);
+}
+
+//The digits of a number too long for the fast path, read by strtod.  strtod follows the locale of the
+//thread, which is switched to the "C" locale around the call; uselocale only affects the calling thread
+static bool parseLongDecimal(const char* start, const char* end, double* value){
+    pthread_once(&cLocaleOnce, &createCLocale);
+    if (cLocale==(locale_t)0){
+        return false;
+    }
+    //the text may not be NUL-terminated, so strtod reads a copy
+    char small[128];
+    size_t length=(size_t)(end-start);
+    char* buffer=(length<sizeof(small)) ? small : malloc(length+1);
+    if (buffer==NULL){
+        return false;
+    }
+    memcpy(buffer, start, length);
+    buffer[length]='\0';
+    locale_t previous=uselocale(cLocale);
+    *value=strtod(buffer, NULL);
+    uselocale(previous);
+    if (buffer!=small){
+        free(buffer);
+    }
+    return true;
+}
+
+bool parseGPXDecimalLength(const char* text, size_t length, double* value){
+    if (text==NULL || value==NULL){
+        return false;
+    }
+    const char* p=text;
+    const char* last=text+length;
+    while (p<last && isSpace(*p)){
+        p++;
+    }
+    const char* start=p;
+    bool negative=(p<last && *p=='-');
+    if (p<last && (*p=='-' || *p=='+')){
+        p++;
+    }
+    uint64_t mantissa=0;
+    int digits=0;
+    int decimals=0;
+    bool exact=true;
+    for (; p<last && *p>='0' && *p<='9'; p++, digits++){
+        exact=exact && mantissa<(EXACT_MANTISSA-9)/10;
+        mantissa=mantissa*10+(*p-'0');
+    }
+    if (p<last && *p=='.'){
+        p++;
+        for (; p<last && *p>='0' && *p<='9'; p++, digits++, decimals++){
+            exact=exact && mantissa<(EXACT_MANTISSA-9)/10;
+            mantissa=mantissa*10+(*p-'0');
+        }
+    }
+    const char* end=p;
+    while (p<last && isSpace(*p)){
+        p++;
+    }
+    //xsd:decimal: at least one digit, no exponent, and nothing else around it but whitespace
+    if (digits==0 || p!=last){
+        return false;
+    }
+    //A mantissa and a power of ten that are both exact doubles give a correctly rounded quotient, which is
+    //all that strtod guarantees.  Coordinates, elevations and the like are well within it
+    if (exact && decimals<=22){
+        double result=(double)mantissa/powersOfTen[decimals];
+        *value=negative ? -result : result;
+        return true;
+    }
+    return parseLongDecimal(start, end, value);
+}
+
+bool parseGPXDecimal(const char* text, double* value){
+    if (text==NULL){
+        return false;
+    }
+    return parseGPXDecimalLength(text, strlen(text), value);
+}
+
+//Writes value with the fewest decimals, up to 9, that read back as the same double.  n/10^k and the
+//decimal text of n with k decimals are both correctly rounded from the same number, so checking the
+//division is enough.  Values that need more digits fall back to printf.
+void formatGPXNumber(double value, char* buffer, size_t size){
+    for (int decimals=0; decimals<=9 && fabs(value)<1e9; decimals++){
+        double scaled=round(value*powersOfTen[decimals]);
+        if (scaled/powersOfTen[decimals]!=value){
+            continue;
+        }
+        //digits of the integer, written backwards, with the decimal point slotted in
+        char digits[24];
+        int length=0;
+        long long n=llabs((long long)scaled);
+        do {
+            if (length==decimals && decimals>0){
+                digits[length++]='.';
+            }
+            digits[length++]=(char)('0'+n%10);
+            n/=10;
+        } while (n>0 || length<=decimals);
+        if (value<0 || (value==0 && signbit(value))){
+            digits[length++]='-';
+        }
+        if ((size_t)length>=size){
+            break;
+        }
+        for (int i=0; i<length; i++){
+            buffer[i]=digits[length-1-i];
+        }
+        buffer[length]='\0';
+        return;
+    }
+    snprintf(buffer, size, "%.15g", value);
+    if (strtod(buffer, NULL)!=value){
+        snprintf(buffer, size, "%.17g", value);
+    }
+}
+
+//The point children with a typed field, in the order of the GPX 1.1 schema.  <speed> is a GPX 1.0
+//element, placed where 1.0 has it
+static const struct {
+    const char* name;
+    unsigned int flag;
+    int rank;
+} pointFields[GPX_NUM_POINT_FIELDS]={
+    {"ele", GPX_POINT_ELEVATION, 0},
+    {"time", GPX_POINT_TIME, 1},
+    {"speed", GPX_POINT_SPEED, 2},
+    {"sat", GPX_POINT_SATELLITES, 12},
+    {"hdop", GPX_POINT_HDOP, 13}
+};
+
+int getPointChildRank(const char* name){
+    //GPX 1.1 wptType children without a typed field; "name" is here so <name> can be placed too
+    static const struct {
+        const char* name;
+        int rank;
+    } others[]={
+        {"magvar", 3}, {"geoidheight", 4}, {"name", 5}, {"cmt", 6}, {"desc", 7}, {"src", 8}, {"link", 9},
+        {"sym", 10}, {"type", 11}, {"fix", 11}, {"vdop", 14}, {"pdop", 15}, {"ageofdgpsdata", 16},
+        {"dgpsid", 17}, {"extensions", 18}
+    };
+    for (int i=0; i<GPX_NUM_POINT_FIELDS; i++){
+        if (strcmp(name, pointFields[i].name)==0){
+            return pointFields[i].rank;
+        }
+    }
+    for (int i=0; i<(int)(sizeof(others)/sizeof(others[0])); i++){
+        if (strcmp(name, others[i].name)==0){
+            return others[i].rank;
+        }
+    }
+    //elements the schema does not know go last
+    return 19;
+}
+
+unsigned int decodePointField(GPXPointFields* fields, const char* name, const char* value){
+    if (name==NULL || value==NULL){
+        return 0;
+    }
+    //the first of repeated children is the one that is decoded
+    bool decoded=false;
+    unsigned int flag=0;
+    if (strcmp(name, "ele")==0){
+        flag=GPX_POINT_ELEVATION;
+        decoded=(fields->present&flag)==0 && parseGPXDecimal(value, &fields->elevation);
+    }
+    else if (strcmp(name, "time")==0){
+        flag=GPX_POINT_TIME;
+        decoded=(fields->present&flag)==0 && parseGPXTime(value, &fields->time);
+    }
+    else if (strcmp(name, "hdop")==0){
+        flag=GPX_POINT_HDOP;
+        decoded=(fields->present&flag)==0 && parseGPXDecimal(value, &fields->hdop);
+    }
+    else if (strcmp(name, "speed")==0){
+        flag=GPX_POINT_SPEED;
+        decoded=(fields->present&flag)==0 && parseGPXDecimal(value, &fields->speed);
+    }
+    else if (strcmp(name, "sat")==0){
+        //xsd:nonNegativeInteger
+        double satellites;
+        flag=GPX_POINT_SATELLITES;
+        decoded=(fields->present&flag)==0 && parseGPXDecimal(value, &satellites) && strchr(value, '.')==NULL
+                && satellites>=0 && satellites<=INT32_MAX;
+        if (decoded){
+            fields->satellites=(int)satellites;
+        }
+    }
+    if (decoded==false){
+        return 0;
+    }
+    fields->present|=flag;
+    return flag;
+}
+
+void decodePointData(Waypoint* w){
+    memset(&w->fields, 0, sizeof(GPXPointFields));
+    ListIterator iter=createIterator(w->otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        decodePointField(&w->fields, d->name, d->value);
+    }
+}
+
+void refreshPointFields(Waypoint* wpt){
+    if (wpt==NULL){
+        return;
+    }
+    //decodePointField leaves the fields that are present alone, so only the omitted ones are kept present
+    wpt->fields.present&=wpt->fields.textOmitted;
+    wpt->fields.textOmitted&=wpt->fields.present;
+    ListIterator iter=createIterator(wpt->otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        decodePointField(&wpt->fields, d->name, d->value);
+    }
+}
+
+int getOmittedPointData(const Waypoint* w, GPXFieldText texts[GPX_NUM_POINT_FIELDS]){
+    const GPXPointFields* fields=&w->fields;
+    int count=0;
+    for (int i=0; i<GPX_NUM_POINT_FIELDS; i++){
+        unsigned int flag=pointFields[i].flag;
+        if ((fields->textOmitted&flag)==0 || (fields->present&flag)==0){
+            continue;
+        }
+        GPXFieldText* text=&texts[count];
+        text->name=pointFields[i].name;
+        text->rank=pointFields[i].rank;
+        if (flag==GPX_POINT_ELEVATION){
+            formatGPXNumber(fields->elevation, text->value, sizeof(text->value));
+        }
+        else if (flag==GPX_POINT_TIME){
+            //a time outside the years formatGPXTime can write is left out
+            if (formatGPXTime(fields->time, text->value, sizeof(text->value))==false){
+                continue;
+            }
+        }
+        else if (flag==GPX_POINT_HDOP){
+            formatGPXNumber(fields->hdop, text->value, sizeof(text->value));
+        }
+        else if (flag==GPX_POINT_SPEED){
+            formatGPXNumber(fields->speed, text->value, sizeof(text->value));
+        }
+        else{
+            snprintf(text->value, sizeof(text->value), "%d", fields->satellites);
+        }
+        count++;
+    }
+    return count;
+}
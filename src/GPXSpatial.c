@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+#define EARTH_RADIUS 6371000.0
+
+//children per node of the tree
+#define NODE_CAPACITY 16
+
+//Bounding box of a node, and the range of its children in the level below it.
+//For leaves the children are hits
+typedef struct {
+    double minLat;
+    double minLon;
+    double maxLat;
+    double maxLon;
+    int first;
+    int count;
+} SpatialNode;
+
+//Sort-Tile-Recursive packed R-tree.  levels[0] are the leaves, levels[numLevels-1] holds the root
+struct gpxSpatialIndex{
+    GPXSpatialHit* hits;
+    int numHits;
+    SpatialNode** levels;
+    int* levelSizes;
+    int numLevels;
+};
+
+//qsort comparators for the STR passes, on the centre of a hit or node
+static int compareHitLon(const void* first, const void* second){
+    double a=((const GPXSpatialHit*)first)->longitude;
+    double b=((const GPXSpatialHit*)second)->longitude;
+    return (a>b)-(a<b);
+}
+
+static int compareHitLat(const void* first, const void* second){
+    double a=((const GPXSpatialHit*)first)->latitude;
+    double b=((const GPXSpatialHit*)second)->latitude;
+    return (a>b)-(a<b);
+}
+
+static int compareNodeLon(const void* first, const void* second){
+    const SpatialNode* a=first;
+    const SpatialNode* b=second;
+    double x=a->minLon+a->maxLon;
+    double y=b->minLon+b->maxLon;
+    return (x>y)-(x<y);
+}
+
+static int compareNodeLat(const void* first, const void* second){
+    const SpatialNode* a=first;
+    const SpatialNode* b=second;
+    double x=a->minLat+a->maxLat;
+    double y=b->minLat+b->maxLat;
+    return (x>y)-(x<y);
+}
+
+//orders items into vertical slices by longitude, and each slice by latitude, so that runs of
+//NODE_CAPACITY consecutive items are spatially compact
+static void sortTiles(void* items, int count, size_t size, int (*byLon)(const void*, const void*), int (*byLat)(const void*, const void*)){
+    int numNodes=(count+NODE_CAPACITY-1)/NODE_CAPACITY;
+    int numSlices=(int)ceil(sqrt((double)numNodes));
+    int sliceSize=numSlices*NODE_CAPACITY;
+    qsort(items, count, size, byLon);
+    for (int start=0; start<count; start+=sliceSize){
+        int length=(count-start<sliceSize) ? count-start : sliceSize;
+        qsort((char*)items+(size_t)start*size, length, size, byLat);
+    }
+}
+
+static void initBox(SpatialNode* node){
+    node->minLat=INFINITY;
+    node->minLon=INFINITY;
+    node->maxLat=-INFINITY;
+    node->maxLon=-INFINITY;
+}
+
+static void growBox(SpatialNode* node, double minLat, double minLon, double maxLat, double maxLon){
+    node->minLat=fmin(node->minLat, minLat);
+    node->minLon=fmin(node->minLon, minLon);
+    node->maxLat=fmax(node->maxLat, maxLat);
+    node->maxLon=fmax(node->maxLon, maxLon);
+}
+
+static void addHit(GPXSpatialHit* hits, int* numHits, GPXPointKind kind, Waypoint* w, Route* r, Track* t, TrackSegment* s, int index, double lat, double lon){
+    GPXSpatialHit* hit=&hits[(*numHits)++];
+    hit->kind=kind;
+    hit->waypoint=w;
+    hit->route=r;
+    hit->track=t;
+    hit->segment=s;
+    hit->index=index;
+    hit->latitude=lat;
+    hit->longitude=lon;
+}
+
+//number of points in the document, counting the ones that only exist in SegmentColumns
+static int countDocPoints(const GPXdoc* doc){
+    int count=getLength(doc->waypoints);
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        count+=getLength(r->waypoints);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            count+=getSegmentNumPoints(s);
+        }
+    }
+    return count;
+}
+
+static int collectList(GPXSpatialHit* hits, int numHits, List* list, GPXPointKind kind, Route* r, Track* t, TrackSegment* s){
+    ListIterator iter=createIterator(list);
+    Waypoint* w;
+    int index=0;
+    while ((w=nextElement(&iter))!=NULL){
+        addHit(hits, &numHits, kind, w, r, t, s, index++, w->latitude, w->longitude);
+    }
+    return numHits;
+}
+
+static int collectHits(const GPXdoc* doc, GPXSpatialHit* hits){
+    int numHits=collectList(hits, 0, doc->waypoints, GPX_WAYPOINT, NULL, NULL, NULL);
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        numHits=collectList(hits, numHits, r->waypoints, GPX_ROUTE_POINT, r, NULL, NULL);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            if (isColumnarSegment(s)){
+                for (int i=0; i<s->columns->length; i++){
+                    addHit(hits, &numHits, GPX_TRACK_POINT, NULL, NULL, t, s, i, s->columns->latitude[i], s->columns->longitude[i]);
+                }
+            }
+            else{
+                numHits=collectList(hits, numHits, s->waypoints, GPX_TRACK_POINT, NULL, t, s);
+            }
+        }
+    }
+    return numHits;
+}
+
+GPXSpatialIndex* buildSpatialIndex(const GPXdoc* doc){
+    if (doc==NULL){
+        return NULL;
+    }
+    GPXSpatialIndex* index=calloc(1, sizeof(GPXSpatialIndex));
+    if (index==NULL){
+        return NULL;
+    }
+    int numPoints=countDocPoints(doc);
+    index->hits=malloc(sizeof(GPXSpatialHit)*(numPoints+1));
+    //enough for a tree of fanout 2 or more over every point
+    index->levels=calloc(32, sizeof(SpatialNode*));
+    index->levelSizes=calloc(32, sizeof(int));
+    if (index->hits==NULL || index->levels==NULL || index->levelSizes==NULL){
+        deleteSpatialIndex(index);
+        return NULL;
+    }
+    index->numHits=collectHits(doc, index->hits);
+    if (index->numHits==0){
+        return index;
+    }
+
+    //leaves over runs of the tiled hits
+    sortTiles(index->hits, index->numHits, sizeof(GPXSpatialHit), &compareHitLon, &compareHitLat);
+    int count=(index->numHits+NODE_CAPACITY-1)/NODE_CAPACITY;
+    SpatialNode* level=malloc(sizeof(SpatialNode)*count);
+    if (level==NULL){
+        deleteSpatialIndex(index);
+        return NULL;
+    }
+    for (int i=0; i<count; i++){
+        SpatialNode* node=&level[i];
+        initBox(node);
+        node->first=i*NODE_CAPACITY;
+        node->count=(index->numHits-node->first<NODE_CAPACITY) ? index->numHits-node->first : NODE_CAPACITY;
+        for (int j=node->first; j<node->first+node->count; j++){
+            GPXSpatialHit* hit=&index->hits[j];
+            growBox(node, hit->latitude, hit->longitude, hit->latitude, hit->longitude);
+        }
+    }
+    index->levels[0]=level;
+    index->levelSizes[0]=count;
+    index->numLevels=1;
+
+    //each level above tiles the nodes of the level below, until a single root is left
+    while (count>1){
+        SpatialNode* below=index->levels[index->numLevels-1];
+        sortTiles(below, count, sizeof(SpatialNode), &compareNodeLon, &compareNodeLat);
+        int parentCount=(count+NODE_CAPACITY-1)/NODE_CAPACITY;
+        SpatialNode* parents=malloc(sizeof(SpatialNode)*parentCount);
+        if (parents==NULL){
+            deleteSpatialIndex(index);
+            return NULL;
+        }
+        for (int i=0; i<parentCount; i++){
+            SpatialNode* node=&parents[i];
+            initBox(node);
+            node->first=i*NODE_CAPACITY;
+            node->count=(count-node->first<NODE_CAPACITY) ? count-node->first : NODE_CAPACITY;
+            for (int j=node->first; j<node->first+node->count; j++){
+                growBox(node, below[j].minLat, below[j].minLon, below[j].maxLat, below[j].maxLon);
+            }
+        }
+        index->levels[index->numLevels]=parents;
+        index->levelSizes[index->numLevels]=parentCount;
+        index->numLevels++;
+        count=parentCount;
+    }
+    return index;
+}
+
+void deleteSpatialIndex(GPXSpatialIndex* index){
+    if (index==NULL){
+        return;
+    }
+    if (index->levels!=NULL){
+        for (int i=0; i<index->numLevels; i++){
+            free(index->levels[i]);
+        }
+    }
+    free(index->levels);
+    free(index->levelSizes);
+    free(index->hits);
+    free(index);
+}
+
+int getSpatialIndexSize(const GPXSpatialIndex* index){
+    return (index!=NULL) ? index->numHits : 0;
+}
+
+//Query state.  A radius query is a box query whose hits are filtered by distance
+typedef struct {
+    double minLat;
+    double minLon;
+    double maxLat;
+    double maxLon;
+    bool byRadius;
+    double centreLat;
+    double centreLon;
+    double radius;
+    bool (*visit)(const GPXSpatialHit* hit, void* userData);
+    void* userData;
+    int found;
+    bool stopped;
+} SpatialQuery;
+
+static bool overlaps(const SpatialNode* node, const SpatialQuery* query){
+    return node->minLat<=query->maxLat && node->maxLat>=query->minLat
+        && node->minLon<=query->maxLon && node->maxLon>=query->minLon;
+}
+
+static void searchNode(const GPXSpatialIndex* index, int level, int position, SpatialQuery* query){
+    const SpatialNode* node=&index->levels[level][position];
+    if (query->stopped || overlaps(node, query)==false){
+        return;
+    }
+    if (level>0){
+        for (int i=node->first; i<node->first+node->count; i++){
+            searchNode(index, level-1, i, query);
+        }
+        return;
+    }
+    for (int i=node->first; i<node->first+node->count && query->stopped==false; i++){
+        const GPXSpatialHit* hit=&index->hits[i];
+        if (hit->latitude<query->minLat || hit->latitude>query->maxLat
+            || hit->longitude<query->minLon || hit->longitude>query->maxLon){
+            continue;
+        }
+        if (query->byRadius && haversineDistance(query->centreLat, query->centreLon, hit->latitude, hit->longitude)>query->radius){
+            continue;
+        }
+        query->found++;
+        if (query->visit!=NULL && query->visit(hit, query->userData)==false){
+            query->stopped=true;
+        }
+    }
+}
+
+//runs the query over [minLon, maxLon], splitting it in two when it wraps around the antimeridian
+static void search(const GPXSpatialIndex* index, SpatialQuery* query){
+    if (index==NULL || index->numHits==0){
+        return;
+    }
+    int root=index->numLevels-1;
+    if (query->minLon<=query->maxLon){
+        searchNode(index, root, 0, query);
+        return;
+    }
+    double minLon=query->minLon;
+    double maxLon=query->maxLon;
+    query->maxLon=180.0;
+    searchNode(index, root, 0, query);
+    query->minLon=-180.0;
+    query->maxLon=maxLon;
+    searchNode(index, root, 0, query);
+    query->minLon=minLon;
+}
+
+int querySpatialBox(const GPXSpatialIndex* index, double minLat, double minLon, double maxLat, double maxLon,
+                    bool (*visit)(const GPXSpatialHit* hit, void* userData), void* userData){
+    SpatialQuery query;
+    memset(&query, 0, sizeof(SpatialQuery));
+    query.minLat=minLat;
+    query.minLon=minLon;
+    query.maxLat=maxLat;
+    query.maxLon=maxLon;
+    query.visit=visit;
+    query.userData=userData;
+    search(index, &query);
+    return query.found;
+}
+
+int querySpatialRadius(const GPXSpatialIndex* index, double latitude, double longitude, double metres,
+                       bool (*visit)(const GPXSpatialHit* hit, void* userData), void* userData){
+    SpatialQuery query;
+    memset(&query, 0, sizeof(SpatialQuery));
+    query.byRadius=true;
+    query.centreLat=latitude;
+    query.centreLon=longitude;
+    query.radius=metres;
+    query.visit=visit;
+    query.userData=userData;
+
+    //box around the circle: a degree of latitude is always the same length, a degree of longitude
+    //shrinks with the cosine of the latitude, and near a pole the circle covers every longitude
+    double dLat=metres/EARTH_RADIUS*180.0/M_PI;
+    query.minLat=latitude-dLat;
+    query.maxLat=latitude+dLat;
+    double maxAbsLat=fmax(fabs(query.minLat), fabs(query.maxLat));
+    if (maxAbsLat>=90.0 || dLat>=90.0){
+        query.minLon=-180.0;
+        query.maxLon=180.0;
+    }
+    else{
+        double dLon=dLat/cos(maxAbsLat*M_PI/180.0);
+        if (dLon>=180.0){
+            query.minLon=-180.0;
+            query.maxLon=180.0;
+        }
+        else{
+            query.minLon=longitude-dLon;
+            query.maxLon=longitude+dLon;
+            if (query.minLon<-180.0){
+                query.minLon+=360.0;
+            }
+            if (query.maxLon>180.0){
+                query.maxLon-=360.0;
+            }
+        }
+    }
+    search(index, &query);
+    return query.found;
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libxml/xmlreader.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//moves the reader to the first element of the document, returns the result of the last xmlTextReaderRead
+static int readToRoot(xmlTextReaderPtr reader){
+    int ret=xmlTextReaderRead(reader);
+    while (ret==1 && xmlTextReaderNodeType(reader)!=XML_READER_TYPE_ELEMENT){
+        ret=xmlTextReaderRead(reader);
+    }
+    return ret;
+}
+
+//creates the GPXdoc from the attributes of the <gpx> element the reader is positioned on
+static GPXdoc* readHeader(xmlTextReaderPtr reader){
+    if (strcmp((char*)xmlTextReaderConstLocalName(reader), "gpx")!=0){
+        return NULL;
+    }
+    char* version=(char*)xmlTextReaderGetAttribute(reader, (xmlChar*)"version");
+    char* creator=(char*)xmlTextReaderGetAttribute(reader, (xmlChar*)"creator");
+    GPXdoc* doc=createEmptyGPXdoc((char*)xmlTextReaderConstNamespaceUri(reader), version, creator);
+    xmlFree(version);
+    xmlFree(creator);
+    return doc;
+}
+
+GPXdoc* readGPXStream(const GPXInput* input){
+    void* decompressor;
+    xmlTextReaderPtr reader=createInputReader(input, &decompressor);
+    if (reader==NULL){
+        return NULL;
+    }
+
+    GPXdoc* doc=NULL;
+    int ret=readToRoot(reader);
+    if (ret==1){
+        doc=readHeader(reader);
+    }
+    if (doc==NULL){
+        xmlFreeTextReader(reader);
+        finishInput(decompressor, false);
+        return NULL;
+    }
+
+    ret=xmlTextReaderRead(reader);
+    while (ret==1){
+        if (xmlTextReaderDepth(reader)==1 && xmlTextReaderNodeType(reader)==XML_READER_TYPE_ELEMENT){
+            //expand only the current top-level element; xmlTextReaderNext then skips past it
+            //and lets the reader free the subtree before the next element is read
+            xmlNode* node=xmlTextReaderExpand(reader);
+            if (node==NULL || addGPXElement(doc, node)==false){
+                ret=-1;
+                break;
+            }
+            ret=xmlTextReaderNext(reader);
+        }
+        else{
+            ret=xmlTextReaderRead(reader);
+        }
+    }
+    xmlFreeTextReader(reader);
+
+    //the reader stops at the end of the root element, so the rest of a compressed input is checked here
+    if (finishInput(decompressor, ret==0)==false){
+        discardGPXdoc(doc);
+        return NULL;
+    }
+    return doc;
+}
@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+static void startSummary(GPXSummary* summary){
+    summary->numPoints=0;
+    summary->minLatitude=INFINITY;
+    summary->minLongitude=INFINITY;
+    summary->maxLatitude=-INFINITY;
+    summary->maxLongitude=-INFINITY;
+    summary->length=0.0;
+    summary->firstTime=GPX_NO_TIME;
+    summary->lastTime=GPX_NO_TIME;
+}
+
+static void addTime(GPXSummary* summary, int64_t time){
+    if (time==GPX_NO_TIME){
+        return;
+    }
+    if (summary->firstTime==GPX_NO_TIME || time<summary->firstTime){
+        summary->firstTime=time;
+    }
+    if (summary->lastTime==GPX_NO_TIME || time>summary->lastTime){
+        summary->lastTime=time;
+    }
+}
+
+static void addPoint(GPXSummary* summary, double latitude, double longitude, int64_t time){
+    summary->numPoints++;
+    summary->minLatitude=fmin(summary->minLatitude, latitude);
+    summary->minLongitude=fmin(summary->minLongitude, longitude);
+    summary->maxLatitude=fmax(summary->maxLatitude, latitude);
+    summary->maxLongitude=fmax(summary->maxLongitude, longitude);
+    addTime(summary, time);
+}
+
+static void addPoints(GPXSummary* summary, List* waypoints){
+    ListIterator iter=createIterator(waypoints);
+    void** points;
+    int numPoints;
+    while ((numPoints=nextElements(&iter, &points))>0){
+        for (int i=0; i<numPoints; i++){
+            const Waypoint* w=points[i];
+            addPoint(summary, w->latitude, w->longitude, getPointTime(w));
+        }
+    }
+}
+
+//the points of a columnar segment are only in its columns
+static void addSegment(GPXSummary* summary, const TrackSegment* segment){
+    if (isColumnarSegment(segment)==false){
+        addPoints(summary, segment->waypoints);
+        return;
+    }
+    const SegmentColumns* columns=segment->columns;
+    for (int i=0; i<columns->length; i++){
+        addPoint(summary, columns->latitude[i], columns->longitude[i],
+                 (columns->time!=NULL) ? columns->time[i] : GPX_NO_TIME);
+    }
+}
+
+//adds a summary that is already finished, whose box is NAN when it has no points
+static void addSummary(GPXSummary* summary, const GPXSummary* part){
+    if (part->numPoints>0){
+        summary->numPoints+=part->numPoints;
+        summary->minLatitude=fmin(summary->minLatitude, part->minLatitude);
+        summary->minLongitude=fmin(summary->minLongitude, part->minLongitude);
+        summary->maxLatitude=fmax(summary->maxLatitude, part->maxLatitude);
+        summary->maxLongitude=fmax(summary->maxLongitude, part->maxLongitude);
+    }
+    summary->length+=part->length;
+    addTime(summary, part->firstTime);
+    addTime(summary, part->lastTime);
+}
+
+static void finishSummary(GPXSummary* summary){
+    if (summary->numPoints==0){
+        summary->minLatitude=NAN;
+        summary->minLongitude=NAN;
+        summary->maxLatitude=NAN;
+        summary->maxLongitude=NAN;
+    }
+}
+
+//The cached summary of one route or track
+typedef struct {
+    const void* element;
+    //the waypoints of the route or the segments of the track, and the version of that list the summary was
+    //made from, so that an element freed behind the table's back and another one made at its address are
+    //not taken for each other
+    const List* list;
+    unsigned long listVersion;
+    bool valid;
+    GPXSummary summary;
+} ElementSummary;
+
+struct gpxSummaryTable{
+    //Open addressing on the address of the element, NULL for empty slots.  Each entry is allocated on its
+    //own so that the summaries handed out stay where they are when the table grows
+    ElementSummary** slots;
+    //always a power of two, at least twice the number of entries
+    size_t capacity;
+    size_t numEntries;
+
+    //the whole document, and its waypoints alone, with the versions of the lists they were made from
+    GPXSummary total;
+    unsigned long totalVersion;
+    bool totalValid;
+    GPXSummary waypoints;
+    unsigned long waypointsVersion;
+    bool waypointsValid;
+};
+
+static size_t hashElement(const void* element){
+    uint64_t hash=(uint64_t)(uintptr_t)element;
+    hash^=hash>>33;
+    hash*=0xff51afd7ed558ccdULL;
+    hash^=hash>>33;
+    return (size_t)hash;
+}
+
+static void insertEntry(ElementSummary** slots, size_t capacity, ElementSummary* entry){
+    size_t i=hashElement(entry->element)&(capacity-1);
+    while (slots[i]!=NULL){
+        i=(i+1)&(capacity-1);
+    }
+    slots[i]=entry;
+}
+
+//makes room for one more entry, dropping the ones that were invalidated, as those of removed elements are
+static bool growTable(struct gpxSummaryTable* table){
+    size_t numValid=0;
+    for (size_t i=0; i<table->capacity; i++){
+        if (table->slots[i]!=NULL && table->slots[i]->valid){
+            numValid++;
+        }
+    }
+    size_t capacity=16;
+    while (capacity<(numValid+1)*4){
+        capacity*=2;
+    }
+    ElementSummary** slots=calloc(capacity, sizeof(ElementSummary*));
+    if (slots==NULL){
+        return false;
+    }
+    for (size_t i=0; i<table->capacity; i++){
+        ElementSummary* entry=table->slots[i];
+        if (entry==NULL){
+            continue;
+        }
+        if (entry->valid){
+            insertEntry(slots, capacity, entry);
+        }
+        else{
+            free(entry);
+        }
+    }
+    free(table->slots);
+    table->slots=slots;
+    table->capacity=capacity;
+    table->numEntries=numValid;
+    return true;
+}
+
+static ElementSummary* findEntry(struct gpxSummaryTable* table, const void* element){
+    if (table->capacity==0){
+        return NULL;
+    }
+    size_t i=hashElement(element)&(table->capacity-1);
+    while (table->slots[i]!=NULL){
+        if (table->slots[i]->element==element){
+            return table->slots[i];
+        }
+        i=(i+1)&(table->capacity-1);
+    }
+    return NULL;
+}
+
+static ElementSummary* addEntry(struct gpxSummaryTable* table, const void* element){
+    if ((table->numEntries+1)*2>table->capacity && growTable(table)==false){
+        return NULL;
+    }
+    ElementSummary* entry=calloc(1, sizeof(ElementSummary));
+    if (entry==NULL){
+        return NULL;
+    }
+    entry->element=element;
+    insertEntry(table->slots, table->capacity, entry);
+    table->numEntries++;
+    return entry;
+}
+
+//the table is a cache, so it is made through the const pointer as the name index is
+static struct gpxSummaryTable* getSummaryTable(const GPXdoc* doc){
+    GPXdoc* writable=(GPXdoc*)doc;
+    if (writable->summaries==NULL){
+        writable->summaries=calloc(1, sizeof(struct gpxSummaryTable));
+    }
+    return writable->summaries;
+}
+
+//the entry of an element, which needs computing again unless it is valid and its list has not changed
+static ElementSummary* getEntry(const GPXdoc* doc, const void* element, const List* list, bool* stale){
+    struct gpxSummaryTable* table=getSummaryTable(doc);
+    if (table==NULL){
+        return NULL;
+    }
+    ElementSummary* entry=findEntry(table, element);
+    if (entry==NULL){
+        entry=addEntry(table, element);
+        if (entry==NULL){
+            return NULL;
+        }
+    }
+    unsigned long version=getListVersion((List*)list);
+    *stale=(entry->valid==false || entry->list!=list || entry->listVersion!=version);
+    if (*stale){
+        entry->list=list;
+        entry->listVersion=version;
+        entry->valid=true;
+    }
+    return entry;
+}
+
+const GPXSummary* getRouteSummary(const GPXdoc* doc, const Route* rt){
+    if (doc==NULL || rt==NULL){
+        return NULL;
+    }
+    bool stale;
+    ElementSummary* entry=getEntry(doc, rt, rt->waypoints, &stale);
+    if (entry==NULL){
+        return NULL;
+    }
+    if (stale){
+        GPXSummary* summary=&entry->summary;
+        startSummary(summary);
+        addPoints(summary, rt->waypoints);
+        summary->length=getRouteLen(rt);
+        finishSummary(summary);
+    }
+    return &entry->summary;
+}
+
+const GPXSummary* getTrackSummary(const GPXdoc* doc, const Track* tr){
+    if (doc==NULL || tr==NULL){
+        return NULL;
+    }
+    bool stale;
+    ElementSummary* entry=getEntry(doc, tr, tr->segments, &stale);
+    if (entry==NULL){
+        return NULL;
+    }
+    if (stale){
+        GPXSummary* summary=&entry->summary;
+        startSummary(summary);
+        ListIterator iter=createIterator(tr->segments);
+        TrackSegment* segment;
+        while ((segment=nextElement(&iter))!=NULL){
+            addSegment(summary, segment);
+        }
+        summary->length=getTrackLen(tr);
+        finishSummary(summary);
+    }
+    return &entry->summary;
+}
+
+static unsigned long getDocVersion(const GPXdoc* doc){
+    return getListVersion(doc->waypoints)+getListVersion(doc->routes)+getListVersion(doc->tracks);
+}
+
+const GPXSummary* getGPXdocSummary(const GPXdoc* doc){
+    if (doc==NULL){
+        return NULL;
+    }
+    struct gpxSummaryTable* table=getSummaryTable(doc);
+    if (table==NULL){
+        return NULL;
+    }
+    unsigned long version=getDocVersion(doc);
+    if (table->totalValid && table->totalVersion==version){
+        return &table->total;
+    }
+    unsigned long waypointsVersion=getListVersion(doc->waypoints);
+    if (table->waypointsValid==false || table->waypointsVersion!=waypointsVersion){
+        startSummary(&table->waypoints);
+        addPoints(&table->waypoints, doc->waypoints);
+        finishSummary(&table->waypoints);
+        table->waypointsVersion=waypointsVersion;
+        table->waypointsValid=true;
+    }
+
+    GPXSummary total;
+    startSummary(&total);
+    addSummary(&total, &table->waypoints);
+    ListIterator iter=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&iter))!=NULL){
+        const GPXSummary* part=getRouteSummary(doc, r);
+        if (part==NULL){
+            return NULL;
+        }
+        addSummary(&total, part);
+    }
+    iter=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&iter))!=NULL){
+        const GPXSummary* part=getTrackSummary(doc, t);
+        if (part==NULL){
+            return NULL;
+        }
+        addSummary(&total, part);
+    }
+    finishSummary(&total);
+    table->total=total;
+    table->totalVersion=version;
+    table->totalValid=true;
+    return &table->total;
+}
+
+void invalidateGPXdocSummary(GPXdoc* doc){
+    if (doc!=NULL && doc->summaries!=NULL){
+        doc->summaries->totalValid=false;
+        doc->summaries->waypointsValid=false;
+    }
+}
+
+//marks the entry of a route or track for computing again, and the total, but not the waypoints of the
+//document, which the element does not touch
+static void invalidateElement(GPXdoc* doc, const void* element){
+    if (doc==NULL || doc->summaries==NULL){
+        return;
+    }
+    if (element!=NULL){
+        ElementSummary* entry=findEntry(doc->summaries, element);
+        if (entry!=NULL){
+            entry->valid=false;
+        }
+    }
+    doc->summaries->totalValid=false;
+}
+
+void invalidateRouteSummary(GPXdoc* doc, Route* rt){
+    invalidateElement(doc, rt);
+}
+
+void invalidateTrackSummary(GPXdoc* doc, Track* tr){
+    invalidateElement(doc, tr);
+}
+
+void freeSummaries(GPXdoc* doc){
+    if (doc==NULL || doc->summaries==NULL){
+        return;
+    }
+    for (size_t i=0; i<doc->summaries->capacity; i++){
+        free(doc->summaries->slots[i]);
+    }
+    free(doc->summaries->slots);
+    free(doc->summaries);
+    doc->summaries=NULL;
+}
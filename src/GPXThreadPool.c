@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//The indices a worker has left to run: [next, end).  The owner takes from the front,
+//thieves take the back half, so each worker keeps running consecutive indices
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} WorkRange;
+
+typedef struct {
+    WorkRange* ranges;
+    int numWorkers;
+    void (*task)(void* context, int index, int worker);
+    void* context;
+} ParallelJob;
+
+typedef struct {
+    ParallelJob* job;
+    int worker;
+} WorkerStart;
+
+static bool takeOwn(WorkRange* range, int* index){
+    bool found=false;
+    pthread_mutex_lock(&range->lock);
+    if (range->next<range->end){
+        *index=range->next++;
+        found=true;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+//moves the back half of another worker's range into the thief's own, returns false once every range is empty
+static bool steal(ParallelJob* job, int thief){
+    for (int i=1; i<job->numWorkers; i++){
+        WorkRange* victim=&job->ranges[(thief+i)%job->numWorkers];
+        pthread_mutex_lock(&victim->lock);
+        int start=victim->next+(victim->end-victim->next)/2;
+        int end=victim->end;
+        if (start<end){
+            victim->end=start;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        if (start<end){
+            WorkRange* own=&job->ranges[thief];
+            pthread_mutex_lock(&own->lock);
+            own->next=start;
+            own->end=end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void runWorker(ParallelJob* job, int worker){
+    int index;
+    do {
+        while (takeOwn(&job->ranges[worker], &index)){
+            job->task(job->context, index, worker);
+        }
+    } while (steal(job, worker));
+}
+
+static void* workerThread(void* arg){
+    WorkerStart* start=arg;
+    runWorker(start->job, start->worker);
+    return NULL;
+}
+
+int getProcessorCount(void){
+    long count=sysconf(_SC_NPROCESSORS_ONLN);
+    return (count>0) ? (int)count : 1;
+}
+
+bool runParallel(int numThreads, int count, void (*task)(void* context, int index, int worker), void* context){
+    if (task==NULL || count<0){
+        return false;
+    }
+    if (numThreads<=0){
+        numThreads=getProcessorCount();
+    }
+    if (numThreads>count){
+        numThreads=count;
+    }
+    if (numThreads<=1){
+        for (int i=0; i<count; i++){
+            task(context, i, 0);
+        }
+        return true;
+    }
+
+    ParallelJob job;
+    job.ranges=malloc(sizeof(WorkRange)*numThreads);
+    WorkerStart* starts=malloc(sizeof(WorkerStart)*numThreads);
+    pthread_t* threads=malloc(sizeof(pthread_t)*numThreads);
+    bool* started=calloc(numThreads, sizeof(bool));
+    if (job.ranges==NULL || starts==NULL || threads==NULL || started==NULL){
+        free(job.ranges);
+        free(starts);
+        free(threads);
+        free(started);
+        return false;
+    }
+    job.numWorkers=numThreads;
+    job.task=task;
+    job.context=context;
+    for (int i=0; i<numThreads; i++){
+        pthread_mutex_init(&job.ranges[i].lock, NULL);
+        job.ranges[i].next=(int)((long)count*i/numThreads);
+        job.ranges[i].end=(int)((long)count*(i+1)/numThreads);
+        starts[i].job=&job;
+        starts[i].worker=i;
+    }
+
+    //the calling thread is worker 0.  A thread that cannot be started leaves its range to be stolen
+    for (int i=1; i<numThreads; i++){
+        started[i]=(pthread_create(&threads[i], NULL, &workerThread, &starts[i])==0);
+    }
+    runWorker(&job, 0);
+    for (int i=1; i<numThreads; i++){
+        if (started[i]){
+            pthread_join(threads[i], NULL);
+        }
+    }
+
+    for (int i=0; i<numThreads; i++){
+        pthread_mutex_destroy(&job.ranges[i].lock);
+    }
+    free(job.ranges);
+    free(starts);
+    free(threads);
+    free(started);
+    return true;
+}
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//A schema file compiled once and kept for the life of the process.  A compiled schema is only read
+//while validating, so every thread shares it; only the validation contexts are per thread
+typedef struct compiledSchema {
+    char* fileName;
+    xmlSchemaPtr schema;
+    struct compiledSchema* next;
+} CompiledSchema;
+
+//A validation context of one thread for one schema
+typedef struct validContext {
+    xmlSchemaPtr schema;
+    xmlSchemaValidCtxtPtr context;
+    struct validContext* next;
+} ValidContext;
+
+static pthread_mutex_t schemaLock=PTHREAD_MUTEX_INITIALIZER;
+static CompiledSchema* schemas=NULL;
+
+static pthread_once_t contextKeyOnce=PTHREAD_ONCE_INIT;
+static pthread_key_t contextKey;
+
+static void freeValidContexts(void* data){
+    ValidContext* v=data;
+    while (v!=NULL){
+        ValidContext* next=v->next;
+        xmlSchemaFreeValidCtxt(v->context);
+        free(v);
+        v=next;
+    }
+}
+
+static void createContextKey(void){
+    pthread_key_create(&contextKey, &freeValidContexts);
+}
+
+//validation errors only decide the return value, they are not printed
+static void ignoreError(void* userData, xmlErrorPtr error){
+}
+
+static xmlSchemaPtr compileSchema(const char* schemaFile){
+    xmlSchemaParserCtxtPtr parser=xmlSchemaNewParserCtxt(schemaFile);
+    if (parser==NULL){
+        return NULL;
+    }
+    xmlSchemaPtr schema=xmlSchemaParse(parser);
+    xmlSchemaFreeParserCtxt(parser);
+    return schema;
+}
+
+xmlSchemaPtr getCompiledSchema(const char* schemaFile){
+    if (schemaFile==NULL || strcmp(schemaFile, "")==0){
+        return NULL;
+    }
+    pthread_mutex_lock(&schemaLock);
+    CompiledSchema* s=schemas;
+    while (s!=NULL && strcmp(s->fileName, schemaFile)!=0){
+        s=s->next;
+    }
+    //Compiled with the lock held, so threads asking for the same file at once compile it only once.
+    //A schema that fails to compile is not cached, and is tried again next time
+    if (s==NULL){
+        xmlSchemaPtr schema=compileSchema(schemaFile);
+        s=(schema!=NULL) ? malloc(sizeof(CompiledSchema)) : NULL;
+        char* fileName=(s!=NULL) ? malloc(strlen(schemaFile)+1) : NULL;
+        if (fileName==NULL){
+            free(s);
+            xmlSchemaFree(schema);
+            pthread_mutex_unlock(&schemaLock);
+            return NULL;
+        }
+        strcpy(fileName, schemaFile);
+        s->fileName=fileName;
+        s->schema=schema;
+        s->next=schemas;
+        schemas=s;
+    }
+    pthread_mutex_unlock(&schemaLock);
+    return s->schema;
+}
+
+//returns the validation context of the calling thread for schema, creating it on first use
+static xmlSchemaValidCtxtPtr getValidContext(xmlSchemaPtr schema){
+    if (pthread_once(&contextKeyOnce, &createContextKey)!=0){
+        return NULL;
+    }
+    ValidContext* first=pthread_getspecific(contextKey);
+    for (ValidContext* v=first; v!=NULL; v=v->next){
+        if (v->schema==schema){
+            return v->context;
+        }
+    }
+    ValidContext* v=malloc(sizeof(ValidContext));
+    if (v==NULL){
+        return NULL;
+    }
+    v->schema=schema;
+    v->context=xmlSchemaNewValidCtxt(schema);
+    if (v->context==NULL){
+        free(v);
+        return NULL;
+    }
+    xmlSchemaSetValidStructuredErrors(v->context, &ignoreError, NULL);
+    v->next=first;
+    if (pthread_setspecific(contextKey, v)!=0){
+        freeValidContexts(v);
+        return NULL;
+    }
+    return v->context;
+}
+
+bool validateXmlDoc(xmlDoc* doc, xmlSchemaPtr schema){
+    if (doc==NULL || schema==NULL){
+        return false;
+    }
+    xmlSchemaValidCtxtPtr context=getValidContext(schema);
+    return context!=NULL && xmlSchemaValidateDoc(context, doc)==0;
+}
+
+bool validateInput(const GPXInput* input, xmlSchemaPtr schema){
+    if (schema==NULL){
+        return false;
+    }
+    xmlSchemaValidCtxtPtr context=getValidContext(schema);
+    if (context==NULL){
+        return false;
+    }
+    //the stream takes the buffer over and frees it
+    void* decompressor;
+    xmlParserInputBufferPtr buffer=createInputBuffer(input, &decompressor);
+    if (buffer==NULL){
+        return false;
+    }
+    bool valid=xmlSchemaValidateStream(context, buffer, XML_CHAR_ENCODING_NONE, NULL, NULL)==0;
+    return finishInput(decompressor, valid);
+}
+
+bool validateGPXFile(const char* fileName, const char* gpxSchemaFile){
+    if (fileName==NULL || strcmp(fileName, "")==0){
+        return false;
+    }
+    xmlSchemaPtr schema=getCompiledSchema(gpxSchemaFile);
+    GPXInput input;
+    if (schema==NULL || openFileInput(fileName, &input)==false){
+        return false;
+    }
+    //validated while it is read, without building a tree
+    bool valid=validateInput(&input, schema);
+    closeInput(&input);
+    return valid;
+}
+
+GPXdoc* createValidGPXdoc(char* fileName, char* gpxSchemaFile){
+    if (gpxSchemaFile==NULL || strcmp(gpxSchemaFile, "")==0){
+        return NULL;
+    }
+    GPXParseOptions options;
+    memset(&options, 0, sizeof(GPXParseOptions));
+    options.schemaFile=gpxSchemaFile;
+    return createGPXdocWithOptions(fileName, &options);
+}
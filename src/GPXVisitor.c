@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+//Kinds of element the visitor is currently inside of
+typedef enum {
+    IN_NOTHING,
+    IN_ROUTE,
+    IN_TRACK,
+    IN_SEGMENT
+} Container;
+
+//Parse state shared by every SAX callback.  Strings are stored back to back in text and referred to by
+//offset until they are handed out, since text may move when it grows.
+typedef struct {
+    xmlParserCtxtPtr ctxt;
+    const GPXVisitor* visitor;
+    bool stopped;
+
+    //depth of the next element to start; the <gpx> root is at depth 0
+    int depth;
+
+    char* text;
+    size_t textLength;
+    size_t textCapacity;
+
+    //name and value offsets of the GPXData collected so far, two per element
+    size_t* dataOffsets;
+    GPXDataView* dataViews;
+    int numData;
+    int dataCapacity;
+
+    size_t nameOffset;
+    bool hasName;
+
+    //set while the text of a <name> or GPXData element is being collected
+    bool capturing;
+    bool capturingName;
+    int captureDepth;
+    size_t captureOffset;
+
+    //depth of the point being read, 0 when not inside a point
+    int pointDepth;
+    WaypointView point;
+
+    Container container;
+    bool begun;
+} VisitState;
+
+static void resetElement(VisitState* state){
+    state->textLength=0;
+    state->numData=0;
+    state->hasName=false;
+}
+
+static bool reserveText(VisitState* state, size_t length){
+    if (state->textLength+length+1<=state->textCapacity){
+        return true;
+    }
+    size_t newCapacity=state->textCapacity*2;
+    while (newCapacity<state->textLength+length+1){
+        newCapacity*=2;
+    }
+    char* newText=realloc(state->text, newCapacity);
+    if (newText==NULL){
+        return false;
+    }
+    state->text=newText;
+    state->textCapacity=newCapacity;
+    return true;
+}
+
+//appends a string to the text buffer, and returns its offset or -1 on failure
+static long appendText(VisitState* state, const char* string){
+    if (string==NULL){
+        string="";
+    }
+    size_t length=strlen(string);
+    if (reserveText(state, length)==false){
+        return -1;
+    }
+    size_t offset=state->textLength;
+    memcpy(state->text+offset, string, length+1);
+    state->textLength+=length+1;
+    return (long)offset;
+}
+
+//starts collecting the text of a child element as either the name or a new GPXData
+static bool beginCapture(VisitState* state, const char* name, int depth){
+    state->capturingName=(strcmp(name, "name")==0);
+    if (state->capturingName==false){
+        if (state->numData==state->dataCapacity){
+            int newCapacity=state->dataCapacity*2;
+            size_t* newOffsets=realloc(state->dataOffsets, sizeof(size_t)*2*newCapacity);
+            if (newOffsets==NULL){
+                return false;
+            }
+            state->dataOffsets=newOffsets;
+            GPXDataView* newViews=realloc(state->dataViews, sizeof(GPXDataView)*newCapacity);
+            if (newViews==NULL){
+                return false;
+            }
+            state->dataViews=newViews;
+            state->dataCapacity=newCapacity;
+        }
+        long nameOffset=appendText(state, name);
+        if (nameOffset<0){
+            return false;
+        }
+        state->dataOffsets[2*state->numData]=(size_t)nameOffset;
+    }
+    long offset=appendText(state, "");
+    if (offset<0){
+        return false;
+    }
+    state->captureOffset=(size_t)offset;
+    state->captureDepth=depth;
+    state->capturing=true;
+    return true;
+}
+
+static void endCapture(VisitState* state){
+    state->capturing=false;
+    if (state->capturingName){
+        state->nameOffset=state->captureOffset;
+        state->hasName=true;
+    }
+    //empty elements are not GPXData, same as in makeGPXData
+    else if (state->text[state->captureOffset]!='\0'){
+        state->dataOffsets[2*state->numData+1]=state->captureOffset;
+        state->numData++;
+    }
+}
+
+//turns the collected offsets into views, now that the text buffer will not move until the next element
+static const char* finishViews(VisitState* state){
+    for (int i=0; i<state->numData; i++){
+        state->dataViews[i].name=state->text+state->dataOffsets[2*i];
+        state->dataViews[i].value=state->text+state->dataOffsets[2*i+1];
+    }
+    return state->hasName ? state->text+state->nameOffset : "";
+}
+
+static bool beginPoint(VisitState* state, GPXPointKind kind, int depth, int numAttributes, const xmlChar** attributes){
+    WaypointView* point=&state->point;
+    point->kind=kind;
+    point->latitude=0.0;
+    point->longitude=0.0;
+    bool hasLatitude=false;
+    bool hasLongitude=false;
+    //SAX2 passes attributes as (localname, prefix, URI, value, end) tuples, with values not null terminated
+    for (int i=0; i<numAttributes; i++){
+        const xmlChar** a=attributes+5*i;
+        size_t length=(size_t)(a[4]-a[3]);
+        if (strcmp((const char*)a[0], "lat")==0){
+            hasLatitude=parseGPXDecimalLength((const char*)a[3], length, &point->latitude);
+        }
+        else if (strcmp((const char*)a[0], "lon")==0){
+            hasLongitude=parseGPXDecimalLength((const char*)a[3], length, &point->longitude);
+        }
+    }
+    //a point with a missing, malformed or out of range coordinate stops the parse, as it fails createGPXdoc
+    if (hasLatitude==false || hasLongitude==false || point->latitude<-90.0 || point->latitude>90.0 || point->longitude<-180.0 || point->longitude>180.0){
+        return false;
+    }
+    resetElement(state);
+    state->pointDepth=depth;
+    return true;
+}
+
+static bool endPoint(VisitState* state){
+    WaypointView* point=&state->point;
+    state->pointDepth=0;
+    point->name=finishViews(state);
+    point->otherData=state->dataViews;
+    point->numData=state->numData;
+    if (state->visitor->onWaypoint!=NULL){
+        return state->visitor->onWaypoint(point, state->visitor->userData);
+    }
+    return true;
+}
+
+//issues the begin callback of the current route or track, once the data that precedes its points is known
+static bool beginContainer(VisitState* state){
+    if (state->begun){
+        return true;
+    }
+    state->begun=true;
+    GPXElementView element;
+    element.name=finishViews(state);
+    element.otherData=state->dataViews;
+    element.numData=state->numData;
+    const GPXVisitor* v=state->visitor;
+    if (state->container==IN_ROUTE && v->onRouteBegin!=NULL){
+        return v->onRouteBegin(&element, v->userData);
+    }
+    if (state->container==IN_TRACK && v->onTrackBegin!=NULL){
+        return v->onTrackBegin(&element, v->userData);
+    }
+    return true;
+}
+
+static bool endContainer(VisitState* state){
+    if (beginContainer(state)==false){
+        return false;
+    }
+    const GPXVisitor* v=state->visitor;
+    Container container=state->container;
+    state->container=IN_NOTHING;
+    if (container==IN_ROUTE && v->onRouteEnd!=NULL){
+        return v->onRouteEnd(v->userData);
+    }
+    if (container==IN_TRACK && v->onTrackEnd!=NULL){
+        return v->onTrackEnd(v->userData);
+    }
+    return true;
+}
+
+static bool beginSegment(VisitState* state){
+    const GPXVisitor* v=state->visitor;
+    if (beginContainer(state)==false){
+        return false;
+    }
+    state->container=IN_SEGMENT;
+    if (v->onSegmentBegin!=NULL){
+        return v->onSegmentBegin(v->userData);
+    }
+    return true;
+}
+
+static bool endSegment(VisitState* state){
+    const GPXVisitor* v=state->visitor;
+    state->container=IN_TRACK;
+    if (v->onSegmentEnd!=NULL){
+        return v->onSegmentEnd(v->userData);
+    }
+    return true;
+}
+
+//handles a start tag, returns false to stop the parse
+static bool visitStart(VisitState* state, const char* name, int depth, int numAttributes, const xmlChar** attributes){
+    if (depth==0){
+        return strcmp(name, "gpx")==0;
+    }
+    //elements nested in a name or GPXData only contribute their text
+    if (state->capturing){
+        return true;
+    }
+    if (state->pointDepth>0){
+        return depth==state->pointDepth+1 ? beginCapture(state, name, depth) : true;
+    }
+
+    if (depth==1){
+        if (strcmp(name, "wpt")==0){
+            return beginPoint(state, GPX_WAYPOINT, depth, numAttributes, attributes);
+        }
+        if (strcmp(name, "rte")==0 || strcmp(name, "trk")==0){
+            state->container=(name[0]=='r') ? IN_ROUTE : IN_TRACK;
+            state->begun=false;
+            resetElement(state);
+        }
+        return true;
+    }
+    if (depth==2 && state->container==IN_ROUTE && strcmp(name, "rtept")==0){
+        return beginContainer(state) && beginPoint(state, GPX_ROUTE_POINT, depth, numAttributes, attributes);
+    }
+    if (depth==2 && state->container==IN_TRACK && strcmp(name, "trkseg")==0){
+        return beginSegment(state);
+    }
+    if (depth==3 && state->container==IN_SEGMENT && strcmp(name, "trkpt")==0){
+        return beginPoint(state, GPX_TRACK_POINT, depth, numAttributes, attributes);
+    }
+    if (depth==2 && (state->container==IN_ROUTE || state->container==IN_TRACK) && state->begun==false){
+        return beginCapture(state, name, depth);
+    }
+    //anything else is not part of the model and is ignored along with its children
+    return true;
+}
+
+//handles an end tag, returns false to stop the parse
+static bool visitEnd(VisitState* state, int depth){
+    if (state->capturing){
+        if (depth==state->captureDepth){
+            endCapture(state);
+        }
+        return true;
+    }
+    if (state->pointDepth>0){
+        return depth==state->pointDepth ? endPoint(state) : true;
+    }
+    if (depth==1 && (state->container==IN_ROUTE || state->container==IN_TRACK)){
+        return endContainer(state);
+    }
+    if (depth==2 && state->container==IN_SEGMENT){
+        return endSegment(state);
+    }
+    return true;
+}
+
+static void stop(VisitState* state){
+    if (state->stopped==false){
+        state->stopped=true;
+        xmlStopParser(state->ctxt);
+    }
+}
+
+static void onStartElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI,
+                           int numNamespaces, const xmlChar** namespaces,
+                           int numAttributes, int numDefaulted, const xmlChar** attributes){
+    VisitState* state=(VisitState*)ctx;
+    int depth=state->depth++;
+    if (state->stopped==false && visitStart(state, (const char*)localname, depth, numAttributes, attributes)==false){
+        stop(state);
+    }
+}
+
+static void onEndElement(void* ctx, const xmlChar* localname, const xmlChar* prefix, const xmlChar* URI){
+    VisitState* state=(VisitState*)ctx;
+    int depth=--state->depth;
+    if (state->stopped==false && visitEnd(state, depth)==false){
+        stop(state);
+    }
+}
+
+static void onCharacters(void* ctx, const xmlChar* ch, int length){
+    VisitState* state=(VisitState*)ctx;
+    if (state->capturing==false || state->stopped){
+        return;
+    }
+    if (reserveText(state, (size_t)length)==false){
+        stop(state);
+        return;
+    }
+    //overwrite the terminator of the string being collected
+    memcpy(state->text+state->textLength-1, ch, (size_t)length);
+    state->textLength+=(size_t)length;
+    state->text[state->textLength-1]='\0';
+}
+
+//parses the input with the SAX handlers above, through the same input layer as the other readers
+static bool visitInput(const GPXInput* input, const GPXVisitor* visitor){
+    xmlSAXHandler handler;
+    memset(&handler, 0, sizeof(xmlSAXHandler));
+    handler.initialized=XML_SAX2_MAGIC;
+    handler.startElementNs=&onStartElement;
+    handler.endElementNs=&onEndElement;
+    handler.characters=&onCharacters;
+    handler.cdataBlock=&onCharacters;
+
+    VisitState state;
+    memset(&state, 0, sizeof(VisitState));
+    state.visitor=visitor;
+    state.textCapacity=1024;
+    state.text=malloc(state.textCapacity);
+    state.dataCapacity=16;
+    state.dataOffsets=malloc(sizeof(size_t)*2*state.dataCapacity);
+    state.dataViews=malloc(sizeof(GPXDataView)*state.dataCapacity);
+    void* decompressor=NULL;
+    state.ctxt=createInputParserCtxt(input, &decompressor);
+
+    bool ok=false;
+    if (state.ctxt!=NULL && state.text!=NULL && state.dataOffsets!=NULL && state.dataViews!=NULL){
+        //swap in our handler for the duration of the parse, the context frees whatever handler it holds
+        xmlSAXHandlerPtr oldHandler=state.ctxt->sax;
+        state.ctxt->sax=&handler;
+        state.ctxt->userData=&state;
+        xmlParseDocument(state.ctxt);
+        state.ctxt->sax=oldHandler;
+        state.ctxt->userData=NULL;
+        ok=state.ctxt->wellFormed && state.stopped==false;
+    }
+
+    if (state.ctxt!=NULL){
+        xmlFreeParserCtxt(state.ctxt);
+    }
+    //a corrupt end of compressed input fails the visit, as it fails the other readers
+    ok=finishInput(decompressor, ok);
+    free(state.text);
+    free(state.dataOffsets);
+    free(state.dataViews);
+    return ok;
+}
+
+bool visitGPXFile(char* fileName, const GPXVisitor* visitor){
+    if (fileName==NULL || strcmp(fileName, "")==0 || visitor==NULL){
+        return false;
+    }
+    GPXInput input;
+    if (openFileInput(fileName, &input)==false){
+        return false;
+    }
+    bool ok=visitInput(&input, visitor);
+    closeInput(&input);
+    return ok;
+}
+
+bool visitGPXFromMemory(const char* buffer, size_t size, const GPXVisitor* visitor){
+    if (buffer==NULL || visitor==NULL){
+        return false;
+    }
+    GPXInput input;
+    openMemoryInput(buffer, size, &input);
+    return visitInput(&input, visitor);
+}
+
+bool visitGPXFromFd(int fd, const GPXVisitor* visitor){
+    if (visitor==NULL){
+        return false;
+    }
+    GPXInput input;
+    if (openFdInput(fd, &input)==false){
+        return false;
+    }
+    bool ok=visitInput(&input, visitor);
+    closeInput(&input);
+    return ok;
+}
@@ -0,0 +1,248 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "GPXHelpers.h"
+#include "GPXParser.h"
+
+static bool writeNumberAttribute(xmlTextWriterPtr writer, const char* name, double value){
+    char buffer[32];
+    formatGPXNumber(value, buffer, sizeof(buffer));
+    return xmlTextWriterWriteAttribute(writer, BAD_CAST name, BAD_CAST buffer)>=0;
+}
+
+static bool writeTextElement(xmlTextWriterPtr writer, const char* name, const char* text){
+    return xmlTextWriterWriteElement(writer, BAD_CAST name, BAD_CAST text)>=0;
+}
+
+static bool writeName(xmlTextWriterPtr writer, const char* name){
+    //the parser gives elements without a <name> an empty one, so those are written without it
+    if (name==NULL || name[0]=='\0'){
+        return true;
+    }
+    return writeTextElement(writer, "name", name);
+}
+
+//writes the GPXData of a route or track, after its name as the schema expects
+static bool writeData(xmlTextWriterPtr writer, List* otherData, const char* name){
+    if (writeName(writer, name)==false){
+        return false;
+    }
+    ListIterator iter=createIterator(otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        if (writeTextElement(writer, d->name, d->value)==false){
+            return false;
+        }
+    }
+    return true;
+}
+
+//What is left to write of a point besides its GPXData: the fields that are only kept typed, and its name
+typedef struct {
+    GPXFieldText texts[GPX_NUM_POINT_FIELDS];
+    int numTexts;
+    int next;
+    bool nameWritten;
+} PendingData;
+
+//writes whatever is pending that the schema puts before an element of the given rank
+static bool writePending(xmlTextWriterPtr writer, Waypoint* w, PendingData* pending, int rank){
+    int nameRank=getPointChildRank("name");
+    while (true){
+        bool hasText=(pending->next<pending->numTexts);
+        bool textFirst=hasText && (pending->nameWritten || pending->texts[pending->next].rank<nameRank);
+        if (textFirst && pending->texts[pending->next].rank<rank){
+            GPXFieldText* text=&pending->texts[pending->next++];
+            if (writeTextElement(writer, text->name, text->value)==false){
+                return false;
+            }
+        }
+        else if (textFirst==false && pending->nameWritten==false && nameRank<rank){
+            pending->nameWritten=true;
+            if (writeName(writer, w->name)==false){
+                return false;
+            }
+        }
+        else{
+            return true;
+        }
+    }
+}
+
+//The children of a point: its GPXData in list order, with <name> and the fields that are only kept typed
+//slotted in where the schema expects them
+static bool writePointData(xmlTextWriterPtr writer, Waypoint* w){
+    PendingData pending;
+    pending.numTexts=getOmittedPointData(w, pending.texts);
+    pending.next=0;
+    pending.nameWritten=false;
+    ListIterator iter=createIterator(w->otherData);
+    GPXData* d;
+    while ((d=nextElement(&iter))!=NULL){
+        if (writePending(writer, w, &pending, getPointChildRank(d->name))==false
+            || writeTextElement(writer, d->name, d->value)==false){
+            return false;
+        }
+    }
+    return writePending(writer, w, &pending, INT_MAX);
+}
+
+static bool writeWaypoint(xmlTextWriterPtr writer, const char* element, Waypoint* w){
+    return xmlTextWriterStartElement(writer, BAD_CAST element)>=0
+        && writeNumberAttribute(writer, "lat", w->latitude)
+        && writeNumberAttribute(writer, "lon", w->longitude)
+        && writePointData(writer, w)
+        && xmlTextWriterEndElement(writer)>=0;
+}
+
+static bool writeWaypoints(xmlTextWriterPtr writer, const char* element, List* waypoints){
+    ListIterator iter=createIterator(waypoints);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        if (writeWaypoint(writer, element, w)==false){
+            return false;
+        }
+    }
+    return true;
+}
+
+//points of a columnar segment, which only have coordinates, <ele> and <time>
+static bool writeColumns(xmlTextWriterPtr writer, const SegmentColumns* columns){
+    for (int i=0; i<columns->length; i++){
+        bool ok=xmlTextWriterStartElement(writer, BAD_CAST "trkpt")>=0
+             && writeNumberAttribute(writer, "lat", columns->latitude[i])
+             && writeNumberAttribute(writer, "lon", columns->longitude[i]);
+        char buffer[32];
+        if (ok && columns->elevation!=NULL && isnan(columns->elevation[i])==false){
+            formatGPXNumber(columns->elevation[i], buffer, sizeof(buffer));
+            ok=writeTextElement(writer, "ele", buffer);
+        }
+        if (ok && columns->time!=NULL && formatGPXTime(columns->time[i], buffer, sizeof(buffer))){
+            ok=writeTextElement(writer, "time", buffer);
+        }
+        if (ok==false || xmlTextWriterEndElement(writer)<0){
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writeRoute(xmlTextWriterPtr writer, Route* r){
+    return xmlTextWriterStartElement(writer, BAD_CAST "rte")>=0
+        && writeData(writer, r->otherData, r->name)
+        && writeWaypoints(writer, "rtept", r->waypoints)
+        && xmlTextWriterEndElement(writer)>=0;
+}
+
+static bool writeTrack(xmlTextWriterPtr writer, Track* t){
+    if (xmlTextWriterStartElement(writer, BAD_CAST "trk")<0 || writeData(writer, t->otherData, t->name)==false){
+        return false;
+    }
+    ListIterator iter=createIterator(t->segments);
+    TrackSegment* s;
+    while ((s=nextElement(&iter))!=NULL){
+        bool ok=xmlTextWriterStartElement(writer, BAD_CAST "trkseg")>=0;
+        if (ok && isColumnarSegment(s)){
+            ok=writeColumns(writer, s->columns);
+        }
+        else if (ok){
+            ok=writeWaypoints(writer, "trkpt", s->waypoints);
+        }
+        if (ok==false || xmlTextWriterEndElement(writer)<0){
+            return false;
+        }
+    }
+    return xmlTextWriterEndElement(writer)>=0;
+}
+
+//writes doc and frees the writer, which flushes its output
+static bool writeDocument(xmlTextWriterPtr writer, const GPXdoc* doc){
+    if (writer==NULL){
+        return false;
+    }
+    char version[32];
+    formatGPXNumber(doc->version, version, sizeof(version));
+    bool ok=xmlTextWriterSetIndent(writer, 1)>=0
+         && xmlTextWriterSetIndentString(writer, BAD_CAST "  ")>=0
+         && xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL)>=0
+         && xmlTextWriterStartElement(writer, BAD_CAST "gpx")>=0;
+    if (ok && doc->namespace[0]!='\0'){
+        ok=xmlTextWriterWriteAttribute(writer, BAD_CAST "xmlns", BAD_CAST doc->namespace)>=0;
+    }
+    ok=ok && xmlTextWriterWriteAttribute(writer, BAD_CAST "version", BAD_CAST version)>=0
+          && xmlTextWriterWriteAttribute(writer, BAD_CAST "creator", BAD_CAST doc->creator)>=0
+          && writeWaypoints(writer, "wpt", doc->waypoints);
+
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while (ok && (r=nextElement(&routes))!=NULL){
+        ok=writeRoute(writer, r);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while (ok && (t=nextElement(&tracks))!=NULL){
+        ok=writeTrack(writer, t);
+    }
+    ok=ok && xmlTextWriterEndDocument(writer)>=0;
+    ok=ok && xmlTextWriterFlush(writer)>=0;
+    xmlFreeTextWriter(writer);
+    return ok;
+}
+
+bool writeGPXdoc(const GPXdoc* doc, const char* fileName){
+    if (doc==NULL || fileName==NULL || strcmp(fileName, "")==0){
+        return false;
+    }
+    //An existing file the caller could not write to is left alone, as opening it for writing would fail
+    struct stat info;
+    bool exists=(stat(fileName, &info)==0);
+    if (exists && access(fileName, W_OK)!=0){
+        return false;
+    }
+
+    //The document is written to a temporary file next to fileName, which replaces it only once it is
+    //complete, so a failed write leaves whatever was there before
+    size_t length=strlen(fileName);
+    char* tempName=malloc(length+sizeof(".XXXXXX"));
+    if (tempName==NULL){
+        return false;
+    }
+    memcpy(tempName, fileName, length);
+    memcpy(tempName+length, ".XXXXXX", sizeof(".XXXXXX"));
+    int fd=mkstemp(tempName);
+    if (fd<0){
+        free(tempName);
+        return false;
+    }
+    //mkstemp makes the file readable by its owner only
+    mode_t mode=exists ? (info.st_mode&07777) : (S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+    bool ok=fchmod(fd, mode)==0 && writeGPXdocToFd(doc, fd);
+    ok=(close(fd)==0) && ok;
+    ok=ok && rename(tempName, fileName)==0;
+    if (ok==false){
+        remove(tempName);
+    }
+    free(tempName);
+    return ok;
+}
+
+bool writeGPXdocToFd(const GPXdoc* doc, int fd){
+    if (doc==NULL || fd<0){
+        return false;
+    }
+    //an output buffer made from a file descriptor leaves it open when it is closed
+    xmlOutputBufferPtr output=xmlOutputBufferCreateFd(fd, NULL);
+    if (output==NULL){
+        return false;
+    }
+    xmlTextWriterPtr writer=xmlNewTextWriter(output);
+    if (writer==NULL){
+        xmlOutputBufferClose(output);
+        return false;
+    }
+    return writeDocument(writer, doc);
+}
@@ -1,5 +1,6 @@
 #include "LinkedListAPI.h"
 #include "assert.h"
+#include <stdint.h>
 
 /** Function to initialize the list metadata head to the appropriate function pointers. Allocates memory to the struct.
 *@return pointer to the list head
@@ -8,13 +9,31 @@
 *@param compareFunction function pointer to compare two nodes of the list in order to test for equality or order
 **/
 List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second)){
+	return initializeListWithStorage(printFunction, deleteFunction, compareFunction, LIST_LINKED, NULL);
+}
+
+List * initializeListWithAllocator(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListAllocator* allocator){
+    assert(allocator != NULL);
+
+	return initializeListWithStorage(printFunction, deleteFunction, compareFunction, LIST_LINKED, allocator);
+}
+
+List * initializeListWithStorage(char* (*printFunction)(void* toBePrinted),void (*deleteFunction)(void* toBeDeleted),int (*compareFunction)(const void* first,const void* second), ListStorage storage, ListAllocator* allocator){
     //Asserts create a partial function...
     assert(printFunction != NULL);
     assert(deleteFunction != NULL);
     assert(compareFunction != NULL);
 
-    List * tmpList = malloc(sizeof(List));
-	
+	List * tmpList;
+	if (allocator == NULL){
+		tmpList = malloc(sizeof(List));
+	}else{
+		tmpList = allocator->allocate(allocator->context, sizeof(List));
+	}
+	if (tmpList == NULL){
+		return NULL;
+	}
+
 	tmpList->head = NULL;
 	tmpList->tail = NULL;
 
@@ -23,10 +42,436 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 	tmpList->deleteData = deleteFunction;
 	tmpList->compare = compareFunction;
 	tmpList->printData = printFunction;
-	
+	tmpList->allocator = allocator;
+	tmpList->appendData = NULL;
+	tmpList->storage = storage;
+	tmpList->firstChunk = NULL;
+	tmpList->lastChunk = NULL;
+	tmpList->nodeBlocks = NULL;
+	tmpList->lastNodeBlock = NULL;
+	tmpList->spareNodes = NULL;
+	tmpList->skipIndex = NULL;
+	tmpList->version = 0;
+
 	return tmpList;
 }
 
+//Allocates a node for the list: a spare one if it has any, otherwise from its allocator if it has one
+static Node* allocateNode(List* list, void* data){
+	if (list->spareNodes != NULL){
+		Node* spare = list->spareNodes;
+		list->spareNodes = spare->next;
+		spare->data = data;
+		spare->previous = NULL;
+		spare->next = NULL;
+		return spare;
+	}
+	if (list->allocator == NULL){
+		return initializeNode(data);
+	}
+
+	Node* tmpNode = list->allocator->allocate(list->allocator->context, sizeof(Node));
+	if (tmpNode == NULL){
+		return NULL;
+	}
+
+	tmpNode->data = data;
+	tmpNode->previous = NULL;
+	tmpNode->next = NULL;
+
+	return tmpNode;
+}
+
+//Allocates size bytes for the list, from its allocator if it has one
+static void* allocateMemory(List* list, size_t size){
+	if (list->allocator == NULL){
+		return malloc(size);
+	}
+	return list->allocator->allocate(list->allocator->context, size);
+}
+
+//Returns a node, or the list struct itself, to wherever it was allocated from
+static void releaseMemory(List* list, void* toBeReleased){
+	if (list->allocator == NULL){
+		free(toBeReleased);
+	}else{
+		list->allocator->release(list->allocator->context, toBeReleased);
+	}
+}
+
+//A run of elements of a LIST_UNROLLED list, in list order
+typedef struct listChunk{
+	struct listChunk* previous;
+	struct listChunk* next;
+	int count;
+	int capacity;
+	void* items[];
+} ListChunk;
+
+//The first chunk of a list is small, so the many short lists of a document stay small, and every chunk
+//appended after it is twice the size of the last one, up to LIST_CHUNK_CAPACITY
+#define FIRST_CHUNK_CAPACITY 4
+
+//Allocates an empty chunk and links it in after previous, or at the front if previous is NULL
+static ListChunk* insertChunk(List* list, ListChunk* previous, int capacity){
+	ListChunk* chunk = allocateMemory(list, sizeof(ListChunk) + capacity * sizeof(void*));
+	if (chunk == NULL){
+		return NULL;
+	}
+
+	chunk->count = 0;
+	chunk->capacity = capacity;
+	chunk->previous = previous;
+	chunk->next = (previous != NULL) ? previous->next : list->firstChunk;
+	if (chunk->next != NULL){
+		chunk->next->previous = chunk;
+	}else{
+		list->lastChunk = chunk;
+	}
+	if (previous != NULL){
+		previous->next = chunk;
+	}else{
+		list->firstChunk = chunk;
+	}
+
+	return chunk;
+}
+
+//Unlinks an empty chunk and releases it
+static void removeChunk(List* list, ListChunk* chunk){
+	if (chunk->previous != NULL){
+		chunk->previous->next = chunk->next;
+	}else{
+		list->firstChunk = chunk->next;
+	}
+	if (chunk->next != NULL){
+		chunk->next->previous = chunk->previous;
+	}else{
+		list->lastChunk = chunk->previous;
+	}
+	releaseMemory(list, chunk);
+}
+
+//Inserts data before element index of chunk.  A full chunk is split in half first
+static bool insertIntoChunk(List* list, ListChunk* chunk, int index, void* data){
+	if (chunk->count == chunk->capacity){
+		ListChunk* upper = insertChunk(list, chunk, chunk->capacity);
+		if (upper == NULL){
+			return false;
+		}
+		int half = chunk->capacity / 2;
+		memcpy(upper->items, chunk->items + half, (chunk->capacity - half) * sizeof(void*));
+		upper->count = chunk->capacity - half;
+		chunk->count = half;
+		if (index > half){
+			chunk = upper;
+			index -= half;
+		}
+	}
+
+	memmove(chunk->items + index + 1, chunk->items + index, (chunk->count - index) * sizeof(void*));
+	chunk->items[index] = data;
+	chunk->count++;
+	list->length++;
+	return true;
+}
+
+//Removes element index of chunk and returns it, releasing the chunk once it is empty
+static void* removeFromChunk(List* list, ListChunk* chunk, int index){
+	void* data = chunk->items[index];
+	chunk->count--;
+	memmove(chunk->items + index, chunk->items + index + 1, (chunk->count - index) * sizeof(void*));
+	if (chunk->count == 0){
+		removeChunk(list, chunk);
+	}
+	list->length--;
+	return data;
+}
+
+static void insertUnrolledBack(List* list, void* toBeAdded){
+	ListChunk* chunk = list->lastChunk;
+	if (chunk == NULL || chunk->count == chunk->capacity){
+		int capacity = FIRST_CHUNK_CAPACITY;
+		if (chunk != NULL){
+			capacity = (chunk->capacity * 2 < LIST_CHUNK_CAPACITY) ? chunk->capacity * 2 : LIST_CHUNK_CAPACITY;
+		}
+		chunk = insertChunk(list, list->lastChunk, capacity);
+		if (chunk == NULL){
+			return;
+		}
+	}
+	chunk->items[chunk->count++] = toBeAdded;
+	list->length++;
+}
+
+//A node of a LIST_SORTED list.  Every node is in the doubly linked list of Node structs, so iteration and
+//both ends work as they do for LIST_LINKED, and a node of height h is also linked into the h-1 sparser
+//levels above it, which searches go along before dropping down a level
+typedef struct skipNode{
+	Node node;
+	int height;
+	//above[i] is the next node at level i+1
+	struct skipNode* above[];
+} SkipNode;
+
+//Each level holds about a quarter of the nodes of the one below, so 16 levels index billions of elements
+#define MAX_SKIP_HEIGHT 16
+
+typedef struct skipIndex{
+	//state of the generator of node heights, one per list so lists built on different threads share nothing
+	uint32_t seed;
+	//height of the tallest node
+	int height;
+	//heads[i] is the first node at level i+1
+	SkipNode* heads[MAX_SKIP_HEIGHT - 1];
+} SkipIndex;
+
+static SkipIndex* getSkipIndex(List* list){
+	if (list->skipIndex == NULL){
+		SkipIndex* index = allocateMemory(list, sizeof(SkipIndex));
+		if (index == NULL){
+			return NULL;
+		}
+		memset(index, 0, sizeof(SkipIndex));
+		index->seed = 2463534242u;
+		index->height = 1;
+		list->skipIndex = index;
+	}
+	return list->skipIndex;
+}
+
+//xorshift32, with each pair of bits giving a 1 in 4 chance of one more level
+static int randomHeight(SkipIndex* index){
+	uint32_t x = index->seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	index->seed = x;
+
+	int height = 1;
+	while (height < MAX_SKIP_HEIGHT && (x & 3) == 0){
+		height++;
+		x >>= 2;
+	}
+	return height;
+}
+
+//Allocates an unlinked node for data.  The list must have its index already
+static SkipNode* allocateSkipNode(List* list, void* data){
+	int height = randomHeight(list->skipIndex);
+	SkipNode* node = allocateMemory(list, sizeof(SkipNode) + (height - 1) * sizeof(SkipNode*));
+	if (node == NULL){
+		return NULL;
+	}
+	node->node.data = data;
+	node->node.previous = NULL;
+	node->node.next = NULL;
+	node->height = height;
+	return node;
+}
+
+//Finds the place of data in the list: before the first element it is not greater than, as insertSorted
+//places it.  Returns the node before that place, or NULL for the front, and sets before[i] to the last
+//node of level i+1 before it, or NULL for the head of the level
+static Node* findSkipPosition(List* list, const void* data, SkipNode* before[]){
+	SkipIndex* index = list->skipIndex;
+	SkipNode* previous = NULL;
+	for (int level = index->height - 1; level >= 1; level--){
+		SkipNode* next = (previous != NULL) ? previous->above[level - 1] : index->heads[level - 1];
+		while (next != NULL && list->compare(data, next->node.data) > 0){
+			previous = next;
+			next = next->above[level - 1];
+		}
+		before[level - 1] = previous;
+	}
+
+	Node* node = (previous != NULL) ? &previous->node : NULL;
+	Node* next = (node != NULL) ? node->next : list->head;
+	while (next != NULL && list->compare(data, next->data) > 0){
+		node = next;
+		next = next->next;
+	}
+	return node;
+}
+
+//Returns the first node equal to data, or NULL, with before set as findSkipPosition sets it
+static SkipNode* findSkipNode(List* list, const void* data, SkipNode* before[]){
+	if (list->skipIndex == NULL){
+		return NULL;
+	}
+	Node* previous = findSkipPosition(list, data, before);
+	Node* node = (previous != NULL) ? previous->next : list->head;
+	if (node == NULL || list->compare(data, node->data) != 0){
+		return NULL;
+	}
+	return (SkipNode*)node;
+}
+
+static void linkSkipNode(List* list, SkipNode* node){
+	SkipIndex* index = list->skipIndex;
+	SkipNode* before[MAX_SKIP_HEIGHT - 1];
+	Node* previous = findSkipPosition(list, node->node.data, before);
+	for (int level = index->height; level < node->height; level++){
+		before[level - 1] = NULL;
+	}
+	if (node->height > index->height){
+		index->height = node->height;
+	}
+
+	for (int level = 1; level < node->height; level++){
+		SkipNode** link = (before[level - 1] != NULL) ? &before[level - 1]->above[level - 1] : &index->heads[level - 1];
+		node->above[level - 1] = *link;
+		*link = node;
+	}
+
+	Node* next = (previous != NULL) ? previous->next : list->head;
+	node->node.previous = previous;
+	node->node.next = next;
+	if (previous != NULL){
+		previous->next = &node->node;
+	}else{
+		list->head = &node->node;
+	}
+	if (next != NULL){
+		next->previous = &node->node;
+	}else{
+		list->tail = &node->node;
+	}
+	list->length++;
+}
+
+//Unlinks a node from the doubly linked chain of the list
+static void unlinkNode(List* list, Node* node){
+	if (node->previous != NULL){
+		node->previous->next = node->next;
+	}else{
+		list->head = node->next;
+	}
+	if (node->next != NULL){
+		node->next->previous = node->previous;
+	}else{
+		list->tail = node->previous;
+	}
+	list->length--;
+}
+
+//Unlinks node from every level it is on.  before[i] must be the node right before it on level i+1, or NULL
+//if it is the head of that level
+static void unlinkSkipNode(List* list, SkipNode* node, SkipNode* before[]){
+	SkipIndex* index = list->skipIndex;
+	for (int level = 1; level < node->height; level++){
+		SkipNode** link = (before[level - 1] != NULL) ? &before[level - 1]->above[level - 1] : &index->heads[level - 1];
+		*link = node->above[level - 1];
+	}
+	while (index->height > 1 && index->heads[index->height - 2] == NULL){
+		index->height--;
+	}
+	unlinkNode(list, &node->node);
+}
+
+static void* removeSkipNode(List* list, const void* toBeDeleted){
+	SkipNode* before[MAX_SKIP_HEIGHT - 1];
+	SkipNode* node = findSkipNode(list, toBeDeleted, before);
+	if (node == NULL){
+		return NULL;
+	}
+
+	//node is the first element not less than toBeDeleted, so on every level it is on it comes right after before
+	unlinkSkipNode(list, node, before);
+	void* data = node->node.data;
+	releaseMemory(list, node);
+	return data;
+}
+
+//Sets before to the nodes right before node on each level.  Elements equal to node may come before it, so the
+//search for its data is followed by a walk past them
+static void findSkipPredecessors(List* list, SkipNode* node, SkipNode* before[]){
+	Node* previous = findSkipPosition(list, node->node.data, before);
+	Node* next = (previous != NULL) ? previous->next : list->head;
+	while (next != &node->node){
+		SkipNode* passed = (SkipNode*)next;
+		for (int level = 1; level < passed->height; level++){
+			before[level - 1] = passed;
+		}
+		next = next->next;
+	}
+}
+
+//Nodes allocated together by insertBackBatch.  They are only released with the whole block, when the
+//list is cleared, so a node of a block that is removed from the list stays allocated until then
+typedef struct nodeBlock{
+	struct nodeBlock* next;
+	int count;
+	Node nodes[];
+} NodeBlock;
+
+//Releases a node that has been unlinked from the list.  Once a list has blocks, a node may or may not be
+//part of one, which cannot be told without searching them, so it is kept as a spare instead
+static void releaseNode(List* list, Node* node){
+	if (list->nodeBlocks == NULL){
+		releaseMemory(list, node);
+		return;
+	}
+	node->previous = NULL;
+	node->next = list->spareNodes;
+	list->spareNodes = node;
+}
+
+//Stands in for the data of the nodes of blocks while the storage of a list is released
+static char blockNodeMark;
+
+//Releases a chain of nodes linked through next, except the nodes of blocks, which have been marked
+static void releaseChain(List* list, Node* node){
+	while (node != NULL){
+		Node* next = node->next;
+		if (node->data != &blockNodeMark){
+			releaseMemory(list, node);
+		}
+		node = next;
+	}
+}
+
+//Releases the nodes or chunks of the list without deleting the data in them, and leaves the list empty
+static void releaseStorage(List* list){
+	ListChunk* chunk = list->firstChunk;
+	while (chunk != NULL){
+		ListChunk* next = chunk->next;
+		releaseMemory(list, chunk);
+		chunk = next;
+	}
+
+	//the data has been deleted or moved to another list by now, so the nodes of blocks can be told apart
+	//from the others by marking all of them, in one pass over the blocks
+	for (NodeBlock* block = list->nodeBlocks; block != NULL; block = block->next){
+		for (int i = 0; i < block->count; i++){
+			block->nodes[i].data = &blockNodeMark;
+		}
+	}
+	releaseChain(list, list->head);
+	releaseChain(list, list->spareNodes);
+
+	NodeBlock* block = list->nodeBlocks;
+	while (block != NULL){
+		NodeBlock* next = block->next;
+		releaseMemory(list, block);
+		block = next;
+	}
+
+	if (list->skipIndex != NULL){
+		releaseMemory(list, list->skipIndex);
+	}
+
+	list->head = NULL;
+	list->tail = NULL;
+	list->firstChunk = NULL;
+	list->lastChunk = NULL;
+	list->nodeBlocks = NULL;
+	list->lastNodeBlock = NULL;
+	list->spareNodes = NULL;
+	list->skipIndex = NULL;
+	list->length = 0;
+	list->version++;
+}
 
 /** Deletes the entire linked list, freeing all memory.
 * uses the supplied function pointer to release allocated memory for the data
@@ -35,9 +480,12 @@ List * initializeList(char* (*printFunction)(void* toBePrinted),void (*deleteFun
 *@return  on success: NULL, on failure: head of list
 **/
 void freeList(List* list){	
+	if (list == NULL){
+		return;
+	}
 
     clearList(list);
-	free(list);
+	releaseMemory(list, list);
 }
 
 /** Clears the list: frees the contents of the list - Node structs and data stored in them - 
@@ -52,23 +500,14 @@ void clearList(List* list){
     if (list == NULL){
 		return;
 	}
-	
-	if (list->head == NULL && list->tail == NULL){
-		return;
-	}
-	
-	Node* tmp;
-	
-	while (list->head != NULL){
-		list->deleteData(list->head->data);
-		tmp = list->head;
-		list->head = list->head->next;
-		free(tmp);
+
+	ListIterator iter = createIterator(list);
+	void* data;
+	while ((data = nextElement(&iter)) != NULL){
+		list->deleteData(data);
 	}
-	
-	list->head = NULL;
-	list->tail = NULL;
-	list->length = 0;
+
+	releaseStorage(list);
 }
 
 /**Function for creating a node for the linked list. 
@@ -104,10 +543,30 @@ void insertBack(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	list->version++;
+
+	if (list->storage == LIST_UNROLLED){
+		insertUnrolledBack(list, toBeAdded);
+		return;
+	}
+	insertBackNode(list, toBeAdded);
+}
+
+Node* insertBackNode(List* list, void* toBeAdded){
+	if (list == NULL || toBeAdded == NULL || list->storage == LIST_UNROLLED){
+		return NULL;
+	}
+	list->version++;
+	if (list->storage == LIST_SORTED){
+		return insertSortedNode(list, toBeAdded);
+	}
 	
-	(list->length)++;
+	Node* newNode = allocateNode(list, toBeAdded);
+	if (newNode == NULL){
+		return NULL;
+	}
 
-	Node* newNode = initializeNode(toBeAdded);
+	(list->length)++;
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -117,6 +576,7 @@ void insertBack(List* list, void* toBeAdded){
         list->tail->next = newNode;
     	list->tail = newNode;
     }
+	return newNode;
 }
 
 /**Inserts a Node at the front of a linked list.  List metadata is updated
@@ -129,10 +589,34 @@ void insertFront(List* list, void* toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	list->version++;
+
+	if (list->storage == LIST_UNROLLED){
+		if (list->firstChunk == NULL){
+			insertUnrolledBack(list, toBeAdded);
+		}else{
+			insertIntoChunk(list, list->firstChunk, 0, toBeAdded);
+		}
+		return;
+	}
+	insertFrontNode(list, toBeAdded);
+}
+
+Node* insertFrontNode(List* list, void* toBeAdded){
+	if (list == NULL || toBeAdded == NULL || list->storage == LIST_UNROLLED){
+		return NULL;
+	}
+	list->version++;
+	if (list->storage == LIST_SORTED){
+		return insertSortedNode(list, toBeAdded);
+	}
 	
-	(list->length)++;
+	Node* newNode = allocateNode(list, toBeAdded);
+	if (newNode == NULL){
+		return NULL;
+	}
 
-	Node* newNode = initializeNode(toBeAdded);
+	(list->length)++;
 	
     if (list->head == NULL && list->tail == NULL){
         list->head = newNode;
@@ -142,6 +626,286 @@ void insertFront(List* list, void* toBeAdded){
         list->head->previous = newNode;
     	list->head = newNode;
     }
+	return newNode;
+}
+
+Node* insertAfter(List* list, Node* node, void* toBeAdded){
+	if (list == NULL || toBeAdded == NULL || list->storage != LIST_LINKED){
+		return NULL;
+	}
+	list->version++;
+	if (node == NULL){
+		return insertFrontNode(list, toBeAdded);
+	}
+
+	Node* newNode = allocateNode(list, toBeAdded);
+	if (newNode == NULL){
+		return NULL;
+	}
+	newNode->previous = node;
+	newNode->next = node->next;
+	if (node->next != NULL){
+		node->next->previous = newNode;
+	}else{
+		list->tail = newNode;
+	}
+	node->next = newNode;
+	(list->length)++;
+	return newNode;
+}
+
+void* removeNode(List* list, Node* node){
+	if (list == NULL || node == NULL || list->storage == LIST_UNROLLED){
+		return NULL;
+	}
+	list->version++;
+
+	void* data = node->data;
+	if (list->storage == LIST_SORTED){
+		SkipNode* before[MAX_SKIP_HEIGHT - 1];
+		findSkipPredecessors(list, (SkipNode*)node, before);
+		unlinkSkipNode(list, (SkipNode*)node, before);
+		releaseMemory(list, node);
+	}else{
+		unlinkNode(list, node);
+		releaseNode(list, node);
+	}
+	return data;
+}
+
+bool insertBackBatch(List* list, void** items, int count){
+	if (list == NULL || items == NULL || count <= 0){
+		return list != NULL && count == 0;
+	}
+	list->version++;
+
+	//chunks are filled directly, and only need an allocation every LIST_CHUNK_CAPACITY elements
+	if (list->storage == LIST_UNROLLED){
+		List added = *list;
+		added.spareNodes = NULL;
+		added.firstChunk = NULL;
+		added.lastChunk = NULL;
+		added.length = 0;
+		for (int i = 0; i < count; i++){
+			if (items[i] == NULL){
+				continue;
+			}
+			ListChunk* chunk = added.lastChunk;
+			if (chunk == NULL || chunk->count == chunk->capacity){
+				chunk = insertChunk(&added, added.lastChunk, LIST_CHUNK_CAPACITY);
+				if (chunk == NULL){
+					releaseStorage(&added);
+					return false;
+				}
+			}
+			chunk->items[chunk->count++] = items[i];
+			added.length++;
+		}
+		return spliceList(list, &added);
+	}
+
+	//every node is allocated, and chained through next, before any is linked in
+	if (list->storage == LIST_SORTED){
+		if (getSkipIndex(list) == NULL){
+			return false;
+		}
+		Node* first = NULL;
+		Node* last = NULL;
+		for (int i = 0; i < count; i++){
+			if (items[i] == NULL){
+				continue;
+			}
+			SkipNode* node = allocateSkipNode(list, items[i]);
+			if (node == NULL){
+				while (first != NULL){
+					Node* next = first->next;
+					releaseMemory(list, first);
+					first = next;
+				}
+				return false;
+			}
+			if (last != NULL){
+				last->next = &node->node;
+			}else{
+				first = &node->node;
+			}
+			last = &node->node;
+		}
+		while (first != NULL){
+			Node* next = first->next;
+			linkSkipNode(list, (SkipNode*)first);
+			first = next;
+		}
+		return true;
+	}
+
+	int numItems = 0;
+	for (int i = 0; i < count; i++){
+		numItems += (items[i] != NULL);
+	}
+	if (numItems == 0){
+		return true;
+	}
+
+	NodeBlock* block = allocateMemory(list, sizeof(NodeBlock) + numItems * sizeof(Node));
+	if (block == NULL){
+		return false;
+	}
+	block->count = numItems;
+	block->next = NULL;
+
+	//the nodes are linked to each other first, and the whole run to the list at the end
+	Node* previous = list->tail;
+	int next = 0;
+	for (int i = 0; i < count; i++){
+		if (items[i] == NULL){
+			continue;
+		}
+		Node* node = &block->nodes[next++];
+		node->data = items[i];
+		node->previous = previous;
+		node->next = NULL;
+		if (previous != NULL){
+			previous->next = node;
+		}else{
+			list->head = node;
+		}
+		previous = node;
+	}
+	list->tail = previous;
+	list->length += numItems;
+
+	if (list->lastNodeBlock != NULL){
+		list->lastNodeBlock->next = block;
+	}else{
+		list->nodeBlocks = block;
+	}
+	list->lastNodeBlock = block;
+	return true;
+}
+
+//Lists can share nodes when they allocate them the same way
+static bool sameAllocator(const List* first, const List* second){
+	if (first->allocator == second->allocator){
+		return true;
+	}
+	return first->allocator != NULL && second->allocator != NULL
+		&& first->allocator->allocate == second->allocator->allocate
+		&& first->allocator->release == second->allocator->release
+		&& first->allocator->context == second->allocator->context;
+}
+
+bool spliceList(List* dst, List* src){
+	if (dst == NULL || src == NULL || dst == src || dst->storage != src->storage || src->storage == LIST_SORTED
+		|| sameAllocator(dst, src) == false){
+		return false;
+	}
+
+	if (src->storage == LIST_UNROLLED){
+		if (src->firstChunk != NULL){
+			src->firstChunk->previous = dst->lastChunk;
+			if (dst->lastChunk != NULL){
+				dst->lastChunk->next = src->firstChunk;
+			}else{
+				dst->firstChunk = src->firstChunk;
+			}
+			dst->lastChunk = src->lastChunk;
+		}
+	}else{
+		if (src->head != NULL){
+			src->head->previous = dst->tail;
+			if (dst->tail != NULL){
+				dst->tail->next = src->head;
+			}else{
+				dst->head = src->head;
+			}
+			dst->tail = src->tail;
+		}
+		//the spares of src may be nodes of its blocks, so they go with them
+		if (src->spareNodes != NULL){
+			Node* last = src->spareNodes;
+			while (last->next != NULL){
+				last = last->next;
+			}
+			last->next = dst->spareNodes;
+			dst->spareNodes = src->spareNodes;
+		}
+		if (src->nodeBlocks != NULL){
+			if (dst->lastNodeBlock != NULL){
+				dst->lastNodeBlock->next = src->nodeBlocks;
+			}else{
+				dst->nodeBlocks = src->nodeBlocks;
+			}
+			dst->lastNodeBlock = src->lastNodeBlock;
+		}
+	}
+	dst->length += src->length;
+	dst->version++;
+	src->version++;
+
+	src->head = NULL;
+	src->tail = NULL;
+	src->firstChunk = NULL;
+	src->lastChunk = NULL;
+	src->nodeBlocks = NULL;
+	src->lastNodeBlock = NULL;
+	src->spareNodes = NULL;
+	src->length = 0;
+	return true;
+}
+
+bool appendList(List* dst, List* src){
+	if (dst == NULL || src == NULL || dst == src){
+		return false;
+	}
+	if (spliceList(dst, src)){
+		return true;
+	}
+
+	if (dst->storage == LIST_SORTED){
+		void** items = (src->length > 0) ? malloc(src->length * sizeof(void*)) : NULL;
+		if (src->length > 0 && items == NULL){
+			return false;
+		}
+		int count = 0;
+		ListIterator iter = createIterator(src);
+		void* data;
+		while ((data = nextElement(&iter)) != NULL){
+			items[count++] = data;
+		}
+		bool added = insertBackBatch(dst, items, count);
+		free(items);
+		if (added){
+			releaseStorage(src);
+		}
+		return added;
+	}
+
+	//The elements are stored again the way dst stores them, in a list of their own that is spliced onto
+	//dst once all of them are in.  Running out of memory part way leaves both lists as they were
+	List moved = *dst;
+	moved.head = NULL;
+	moved.tail = NULL;
+	moved.firstChunk = NULL;
+	moved.lastChunk = NULL;
+	moved.nodeBlocks = NULL;
+	moved.lastNodeBlock = NULL;
+	moved.spareNodes = NULL;
+	moved.length = 0;
+	ListIterator iter = createIterator(src);
+	void* data;
+	while ((data = nextElement(&iter)) != NULL){
+		int length = moved.length;
+		insertBack(&moved, data);
+		if (moved.length == length){
+			releaseStorage(&moved);
+			return false;
+		}
+	}
+
+	spliceList(dst, &moved);
+	releaseStorage(src);
+	return true;
 }
 
 /**Returns a pointer to the data at the front of the list. Does not alter list structure.
@@ -150,6 +914,10 @@ void insertFront(List* list, void* toBeAdded){
  *@return pointer to the data located at the head of the list
  **/
 void* getFromFront(List * list){
+	if (list->storage == LIST_UNROLLED){
+		return (list->firstChunk != NULL) ? list->firstChunk->items[0] : NULL;
+	}
+
 	if (list->head == NULL){
 		return NULL;
 	}
@@ -163,6 +931,10 @@ void* getFromFront(List * list){
  *@return pointer to the data located at the tail of the list
  **/
 void* getFromBack(List * list){
+	if (list->storage == LIST_UNROLLED){
+		return (list->lastChunk != NULL) ? list->lastChunk->items[list->lastChunk->count - 1] : NULL;
+	}
+
 	if (list->tail == NULL){
 		return NULL;
 	}
@@ -174,6 +946,21 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 	if (list == NULL || toBeDeleted == NULL){
 		return NULL;
 	}
+	list->version++;
+
+	if (list->storage == LIST_UNROLLED){
+		for (ListChunk* chunk = list->firstChunk; chunk != NULL; chunk = chunk->next){
+			for (int i = 0; i < chunk->count; i++){
+				if (list->compare(toBeDeleted, chunk->items[i]) == 0){
+					return removeFromChunk(list, chunk, i);
+				}
+			}
+		}
+		return NULL;
+	}
+	if (list->storage == LIST_SORTED){
+		return removeSkipNode(list, toBeDeleted);
+	}
 	
 	Node* tmp = list->head;
 	
@@ -181,23 +968,10 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 		if (list->compare(toBeDeleted, tmp->data) == 0){
 			//Unlink the node
 			Node* delNode = tmp;
-			
-			if (tmp->previous != NULL){
-				tmp->previous->next = delNode->next;
-			}else{
-				list->head = delNode->next;
-			}
-			
-			if (tmp->next != NULL){
-				tmp->next->previous = delNode->previous;
-			}else{
-				list->tail = delNode->previous;
-			}
+			unlinkNode(list, delNode);
 			
 			void* data = delNode->data;
-			free(delNode);
-			
-			(list->length)--;
+			releaseNode(list, delNode);
 
 			return data;
 			
@@ -209,6 +983,31 @@ void* deleteDataFromList(List* list, void* toBeDeleted){
 	return NULL;
 }
 
+bool removeFromList(List* list, void* element){
+	if (list == NULL || element == NULL){
+		return false;
+	}
+	if (list->storage == LIST_UNROLLED){
+		for (ListChunk* chunk = list->firstChunk; chunk != NULL; chunk = chunk->next){
+			for (int i = 0; i < chunk->count; i++){
+				if (chunk->items[i] == element){
+					list->version++;
+					removeFromChunk(list, chunk, i);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+	for (Node* node = list->head; node != NULL; node = node->next){
+		if (node->data == element){
+			removeNode(list, node);
+			return true;
+		}
+	}
+	return false;
+}
+
 
 /** Uses the comparison function pointer to place the element in the 
 * appropriate position in the list.
@@ -223,49 +1022,200 @@ void insertSorted(List *list, void *toBeAdded){
 	if (list == NULL || toBeAdded == NULL){
 		return;
 	}
+	list->version++;
 
-	if (list->head == NULL){
-		insertBack(list, toBeAdded);
+	//the same position a linked list would give, which differs from a plain scan when the list is not sorted
+	if (list->storage == LIST_UNROLLED){
+		if (list->firstChunk == NULL || (list->compare(toBeAdded, getFromFront(list)) > 0 && list->compare(toBeAdded, getFromBack(list)) > 0)){
+			insertUnrolledBack(list, toBeAdded);
+			return;
+		}
+		for (ListChunk* chunk = list->firstChunk; chunk != NULL; chunk = chunk->next){
+			for (int i = 0; i < chunk->count; i++){
+				if (list->compare(toBeAdded, chunk->items[i]) <= 0){
+					insertIntoChunk(list, chunk, i, toBeAdded);
+					return;
+				}
+			}
+		}
+		insertUnrolledBack(list, toBeAdded);
 		return;
 	}
+	insertSortedNode(list, toBeAdded);
+}
+
+Node* insertSortedNode(List* list, void* toBeAdded){
+	if (list == NULL || toBeAdded == NULL || list->storage == LIST_UNROLLED){
+		return NULL;
+	}
+	list->version++;
+	if (list->storage == LIST_SORTED){
+		SkipNode* node = (getSkipIndex(list) != NULL) ? allocateSkipNode(list, toBeAdded) : NULL;
+		if (node == NULL){
+			return NULL;
+		}
+		linkSkipNode(list, node);
+		return &node->node;
+	}
+
+	if (list->head == NULL){
+		return insertBackNode(list, toBeAdded);
+	}
 	
 	if (list->compare(toBeAdded, list->head->data) <= 0){
-		insertFront(list, toBeAdded);
-		return;
+		return insertFrontNode(list, toBeAdded);
 	}
 	
 	if (list->compare(toBeAdded, list->tail->data) > 0){
-		insertBack(list, toBeAdded);
-		return;
+		return insertBackNode(list, toBeAdded);
 	}
 	
 	Node* currNode = list->head;
 	
 	while (currNode != NULL){
 		if (list->compare(toBeAdded, currNode->data) <= 0){
-		
-			char* currDescr = list->printData(currNode->data); 
-			char* newDescr = list->printData(toBeAdded); 
-		
-			//printf("Inserting %s before %s\n", newDescr, currDescr);
-
-			free(currDescr);
-			free(newDescr);
-		
-			Node* newNode = initializeNode(toBeAdded);
+			Node* newNode = allocateNode(list, toBeAdded);
+			if (newNode == NULL){
+				return NULL;
+			}
 			newNode->next = currNode;
 			newNode->previous = currNode->previous;
 			currNode->previous->next = newNode;
 			currNode->previous = newNode;
 			(list->length)++;
 
-			return;
+			return newNode;
 		}
 	
 		currNode = currNode->next;
 	}
 	
-	return;
+	return NULL;
+}
+
+//Merges two sorted runs of nodes chained through next.  Ties go to first, which holds the earlier elements
+static Node* mergeNodes(Node* first, Node* second, int (*compare)(const void* first, const void* second)){
+	Node merged;
+	Node* last = &merged;
+	while (first != NULL && second != NULL){
+		if (compare(first->data, second->data) <= 0){
+			last->next = first;
+			first = first->next;
+		}else{
+			last->next = second;
+			second = second->next;
+		}
+		last = last->next;
+	}
+	last->next = (first != NULL) ? first : second;
+	return merged.next;
+}
+
+//Bottom-up merge sort of the chain of nodes.  pending[i] is NULL or a sorted run of 2^i nodes, every run
+//holding earlier elements than the runs below it, and each node taken off the chain is carried up through
+//them like a binary counter.  Runs are merged while they are still in cache, with no extra memory
+static void sortNodes(List* list, int (*compare)(const void* first, const void* second)){
+	Node* pending[sizeof(int) * 8] = {NULL};
+	Node* node = list->head;
+	while (node != NULL){
+		Node* run = node;
+		node = node->next;
+		run->next = NULL;
+		int i = 0;
+		while (pending[i] != NULL){
+			run = mergeNodes(pending[i], run, compare);
+			pending[i] = NULL;
+			i++;
+		}
+		pending[i] = run;
+	}
+
+	Node* sorted = NULL;
+	for (int i = 0; i < (int)(sizeof(pending) / sizeof(pending[0])); i++){
+		if (pending[i] != NULL){
+			sorted = mergeNodes(pending[i], sorted, compare);
+		}
+	}
+
+	//only next was kept up to date by the merges
+	Node* previous = NULL;
+	for (node = sorted; node != NULL; node = node->next){
+		node->previous = previous;
+		previous = node;
+	}
+	list->head = sorted;
+	list->tail = previous;
+}
+
+//Bottom-up merge sort of the elements of a LIST_UNROLLED list, which are copied out and written back into
+//the same chunks
+static bool sortChunks(List* list, int (*compare)(const void* first, const void* second)){
+	void** items = malloc(list->length * sizeof(void*));
+	void** scratch = malloc(list->length * sizeof(void*));
+	if (items == NULL || scratch == NULL){
+		free(items);
+		free(scratch);
+		return false;
+	}
+	int length = 0;
+	for (ListChunk* chunk = list->firstChunk; chunk != NULL; chunk = chunk->next){
+		memcpy(items + length, chunk->items, chunk->count * sizeof(void*));
+		length += chunk->count;
+	}
+
+	for (int width = 1; width < length; width *= 2){
+		for (int start = 0; start < length; start += 2 * width){
+			int middle = (start + width < length) ? start + width : length;
+			int end = (middle + width < length) ? middle + width : length;
+			int i = start;
+			int j = middle;
+			int k = start;
+			while (i < middle && j < end){
+				scratch[k++] = (compare(items[i], items[j]) <= 0) ? items[i++] : items[j++];
+			}
+			while (i < middle){
+				scratch[k++] = items[i++];
+			}
+			while (j < end){
+				scratch[k++] = items[j++];
+			}
+		}
+		void** swap = items;
+		items = scratch;
+		scratch = swap;
+	}
+
+	length = 0;
+	for (ListChunk* chunk = list->firstChunk; chunk != NULL; chunk = chunk->next){
+		memcpy(chunk->items, items + length, chunk->count * sizeof(void*));
+		length += chunk->count;
+	}
+	free(items);
+	free(scratch);
+	return true;
+}
+
+bool sortList(List* list, int (*compare)(const void* first, const void* second)){
+	if (list == NULL){
+		return false;
+	}
+	if (compare == NULL){
+		compare = list->compare;
+	}
+
+	//a sorted list is always in the order of its own compare function, and may not be put in any other
+	if (list->storage == LIST_SORTED){
+		return compare == list->compare;
+	}
+	if (list->length < 2){
+		return true;
+	}
+	list->version++;
+	if (list->storage == LIST_UNROLLED){
+		return sortChunks(list, compare);
+	}
+	sortNodes(list, compare);
+	return true;
 }
 
 /**Returns a string that contains a string representation of the list traversed from  head to tail. 
@@ -276,35 +1226,147 @@ returned string must be freed by the calling function.
  *@return on success: char * to string representation of list (must be freed after use).  on failure: NULL
  **/
 char* toString(List * list){
+	StringBuilder builder;
+	initializeStringBuilder(&builder);
+	appendListToString(list, &builder);
+	return finishStringBuilder(&builder);
+}
+
+bool appendListToString(List* list, StringBuilder* builder){
+	if (list == NULL || builder == NULL){
+		return false;
+	}
+
 	ListIterator iter = createIterator(list);
-	char* str;
-		
-	str = (char*)malloc(sizeof(char));
-	strcpy(str, "");
-	
 	void* elem;
 	while((elem = nextElement(&iter)) != NULL){
-		char* currDescr = list->printData(elem);
-		int newLen = strlen(str)+50+strlen(currDescr);
-		str = (char*)realloc(str, newLen);
-		//strcat(str, "\n");
-		strcat(str, currDescr);
-		
-		free(currDescr);
+		if (list->appendData != NULL){
+			list->appendData(builder, elem);
+		}else{
+			char* currDescr = list->printData(elem);
+			appendString(builder, currDescr);
+			free(currDescr);
+		}
 	}
-	
-	return str;
+
+	return builder->capacity != SIZE_MAX;
+}
+
+void setListAppender(List* list, void (*appendFunction)(StringBuilder* builder, void* toBeAppended)){
+	if (list != NULL){
+		list->appendData = appendFunction;
+	}
+}
+
+//A builder that ran out of memory is marked with capacity SIZE_MAX and no text
+
+void initializeStringBuilder(StringBuilder* builder){
+	builder->text = NULL;
+	builder->length = 0;
+	builder->capacity = 0;
+}
+
+//Makes room for extra more characters and the terminating NUL, doubling the buffer as needed
+static bool reserveString(StringBuilder* builder, size_t extra){
+	if (builder->capacity == SIZE_MAX){
+		return false;
+	}
+	size_t needed = builder->length + extra + 1;
+	if (needed <= builder->capacity){
+		return true;
+	}
+
+	size_t capacity = (builder->capacity < 64) ? 64 : builder->capacity;
+	while (capacity < needed){
+		capacity *= 2;
+	}
+	char* text = realloc(builder->text, capacity);
+	if (text == NULL){
+		freeStringBuilder(builder);
+		builder->capacity = SIZE_MAX;
+		return false;
+	}
+	builder->text = text;
+	builder->capacity = capacity;
+	return true;
+}
+
+bool appendString(StringBuilder* builder, const char* text){
+	if (text == NULL){
+		return builder->capacity != SIZE_MAX;
+	}
+	size_t length = strlen(text);
+	if (reserveString(builder, length) == false){
+		return false;
+	}
+	memcpy(builder->text + builder->length, text, length + 1);
+	builder->length += length;
+	return true;
+}
+
+bool appendFormat(StringBuilder* builder, const char* format, ...){
+	//formats straight into the buffer, growing it and trying again if the text did not fit
+	if (reserveString(builder, 64) == false){
+		return false;
+	}
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(builder->text + builder->length, builder->capacity - builder->length, format, args);
+	va_end(args);
+	if (length < 0){
+		builder->text[builder->length] = '\0';
+		return false;
+	}
+	if ((size_t)length >= builder->capacity - builder->length){
+		if (reserveString(builder, length) == false){
+			return false;
+		}
+		va_start(args, format);
+		vsnprintf(builder->text + builder->length, builder->capacity - builder->length, format, args);
+		va_end(args);
+	}
+	builder->length += length;
+	return true;
+}
+
+char* finishStringBuilder(StringBuilder* builder){
+	if (builder->capacity == SIZE_MAX){
+		initializeStringBuilder(builder);
+		return NULL;
+	}
+	if (builder->text == NULL){
+		return calloc(1, sizeof(char));
+	}
+	char* text = builder->text;
+	initializeStringBuilder(builder);
+	return text;
+}
+
+void freeStringBuilder(StringBuilder* builder){
+	free(builder->text);
+	initializeStringBuilder(builder);
 }
 
 ListIterator createIterator(List* list){
     ListIterator iter;
 
     iter.current = list->head;
+    iter.chunk = list->firstChunk;
+    iter.index = 0;
     
     return iter;
 }
 
 void* nextElement(ListIterator* iter){
+    if (iter->chunk != NULL){
+        void* data = iter->chunk->items[iter->index++];
+        if (iter->index == iter->chunk->count){
+            iter->chunk = iter->chunk->next;
+            iter->index = 0;
+        }
+        return data;
+    }
+
     Node* tmp = iter->current;
     
     if (tmp != NULL){
@@ -315,10 +1377,45 @@ void* nextElement(ListIterator* iter){
     }
 }
 
+int nextElements(ListIterator* iter, void*** elements){
+    if (iter->chunk != NULL){
+        int count = iter->chunk->count - iter->index;
+        *elements = iter->chunk->items + iter->index;
+        iter->chunk = iter->chunk->next;
+        iter->index = 0;
+        return count;
+    }
+
+    Node* tmp = iter->current;
+    if (tmp == NULL){
+        return 0;
+    }
+    iter->current = tmp->next;
+    *elements = &tmp->data;
+    return 1;
+}
+
+Node* nextNode(ListIterator* iter){
+    //the elements of an unrolled list have no nodes
+    if (iter->chunk != NULL){
+        return NULL;
+    }
+
+    Node* tmp = iter->current;
+    if (tmp != NULL){
+        iter->current = tmp->next;
+    }
+    return tmp;
+}
+
 int getLength(List* list){
 	return list->length;
 }
 
+unsigned long getListVersion(List* list){
+	return list->version;
+}
+
 void* findElement(List * list, bool (*customCompare)(const void* first,const void* second), const void* searchRecord){
 	if (list == NULL || customCompare == NULL || searchRecord == NULL)
 		return NULL;
@@ -337,3 +1434,24 @@ void* findElement(List * list, bool (*customCompare)(const void* first,const voi
 
 	return NULL;
 }
+
+void* findSortedElement(List* list, const void* searchRecord){
+	if (list == NULL || searchRecord == NULL){
+		return NULL;
+	}
+
+	if (list->storage == LIST_SORTED){
+		SkipNode* before[MAX_SKIP_HEIGHT - 1];
+		SkipNode* node = findSkipNode(list, searchRecord, before);
+		return (node != NULL) ? node->node.data : NULL;
+	}
+
+	ListIterator iter = createIterator(list);
+	void* data;
+	while ((data = nextElement(&iter)) != NULL){
+		if (list->compare(searchRecord, data) == 0){
+			return data;
+		}
+	}
+	return NULL;
+}
@@ -0,0 +1,772 @@
+/*
+ * Benchmark driver for the parser library.
+ * Usage: bin/benchmark file.gpx [gpx.xsd]
+ * Each benchmark parses the file from scratch and reports wall-clock time and points per second.
+ */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <zlib.h>
+#include "GPXParser.h"
+
+static double now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec/1e9;
+}
+
+static void report(char* name, double seconds, long points){
+    printf("%-28s %10.3f s %12ld points %12.0f points/s\n", name, seconds, points, points/seconds);
+}
+
+static long countPoints(GPXdoc* doc){
+    long count=getLength(doc->waypoints);
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        count+=getLength(r->waypoints);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            count+=getSegmentNumPoints(s);
+        }
+    }
+    return count;
+}
+
+//the options of createGPXdoc, or of createGPXdocStreaming, for a benchmark to configure further
+static GPXParseOptions makeOptions(bool streaming){
+    GPXParseOptions options;
+    memset(&options, 0, sizeof(GPXParseOptions));
+    options.streaming=streaming;
+    return options;
+}
+
+//counts the points of a document timed from start, and reports and deletes it
+static void finishDoc(char* name, double start, GPXdoc* doc){
+    if (doc==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    long points=countPoints(doc);
+    deleteGPXdoc(doc);
+    report(name, now()-start, points);
+}
+
+static void benchDoc(char* name, const GPXParseOptions* options, char* fileName){
+    double start=now();
+    finishDoc(name, start, createGPXdocWithOptions(fileName, options));
+}
+
+static void benchFd(char* name, char* fileName){
+    double start=now();
+    int fd=open(fileName, O_RDONLY);
+    GPXdoc* doc=(fd>=0) ? createGPXdocFromFd(fd) : NULL;
+    if (fd>=0){
+        close(fd);
+    }
+    finishDoc(name, start, doc);
+}
+
+//times only the parse; the file is read into memory beforehand, as a payload from a socket would be
+static void benchMemory(char* name, bool streaming, char* fileName){
+    FILE* file=fopen(fileName, "rb");
+    char* buffer=NULL;
+    long size=-1;
+    if (file!=NULL && fseek(file, 0, SEEK_END)==0 && (size=ftell(file))>=0){
+        rewind(file);
+        buffer=malloc(size+1);
+        if (buffer!=NULL && fread(buffer, 1, size, file)!=(size_t)size){
+            free(buffer);
+            buffer=NULL;
+        }
+    }
+    if (file!=NULL){
+        fclose(file);
+    }
+    GPXParseOptions options=makeOptions(streaming);
+    double start=now();
+    finishDoc(name, start, (buffer!=NULL) ? createGPXdocFromMemoryWithOptions(buffer, size, &options) : NULL);
+    free(buffer);
+}
+
+//parses a gzip copy of the file, made beforehand, from the compressed bytes
+static void benchCompressed(char* fileName){
+    char path[]="/tmp/gpxbenchXXXXXX";
+    int fd=mkstemp(path);
+    FILE* file=fopen(fileName, "rb");
+    gzFile compressed=(fd>=0) ? gzdopen(fd, "wb") : NULL;
+    bool written=(file!=NULL && compressed!=NULL);
+    char buffer[65536];
+    size_t count;
+    while (written && (count=fread(buffer, 1, sizeof(buffer), file))>0){
+        written=gzwrite(compressed, buffer, (unsigned)count)==(int)count;
+    }
+    if (file!=NULL){
+        fclose(file);
+    }
+    if (compressed!=NULL){
+        written=(gzclose(compressed)==Z_OK) && written;
+    }
+    else if (fd>=0){
+        close(fd);
+    }
+    if (written){
+        GPXParseOptions options=makeOptions(true);
+        benchDoc("createGPXdoc, gzip", NULL, path);
+        benchDoc("createGPXdocStreaming, gzip", &options, path);
+    }
+    else{
+        printf("%-28s failed\n", "gzip");
+    }
+    if (fd>=0){
+        remove(path);
+    }
+}
+
+//sums the length of every route and track of the document
+static double documentLength(GPXdoc* doc){
+    double total=0.0;
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        total+=getRouteLen(r);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        total+=getTrackLen(t);
+    }
+    return total;
+}
+
+static void benchLength(char* name, const GPXParseOptions* options, char* fileName){
+    GPXdoc* doc=createGPXdocWithOptions(fileName, options);
+    if (doc==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    double start=now();
+    double length=documentLength(doc);
+    report(name, now()-start, countPoints(doc));
+    printf("%-28s %10.0f m\n", "", length);
+    deleteGPXdoc(doc);
+}
+
+#define NUM_SUMMARIES 1000
+
+//times the first getGPXdocSummary, which walks the document, then NUM_SUMMARIES cached calls
+//and one call after the first track is invalidated
+static void benchSummary(char* fileName){
+    GPXParseOptions options=makeOptions(true);
+    options.columnarSegments=true;
+    GPXdoc* doc=createGPXdocWithOptions(fileName, &options);
+    if (doc==NULL){
+        printf("%-28s failed\n", "summary");
+        return;
+    }
+    double start=now();
+    const GPXSummary* summary=getGPXdocSummary(doc);
+    report("summary, first call", now()-start, summary->numPoints);
+
+    start=now();
+    long points=0;
+    for (int i=0; i<NUM_SUMMARIES; i++){
+        points+=getGPXdocSummary(doc)->numPoints;
+    }
+    report("summary, cached", now()-start, points);
+
+    Track* t=getFromFront(doc->tracks);
+    if (t!=NULL){
+        invalidateTrackSummary(doc, t);
+        start=now();
+        summary=getGPXdocSummary(doc);
+        report("summary, one track changed", now()-start, getTrackSummary(doc, t)->numPoints);
+    }
+    printf("%-28s %10.0f m, lat %.5f..%.5f, lon %.5f..%.5f\n", "", summary->length,
+           summary->minLatitude, summary->maxLatitude, summary->minLongitude, summary->maxLongitude);
+    deleteGPXdoc(doc);
+}
+
+//times getSegmentColumns on every segment, which reads the <ele> and <time> of every point
+static void benchColumns(char* name, const GPXParseOptions* options, char* fileName){
+    GPXdoc* doc=createGPXdocWithOptions(fileName, options);
+    if (doc==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    double start=now();
+    long points=0;
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            SegmentColumns* columns=getSegmentColumns(s);
+            points+=(columns!=NULL) ? columns->length : 0;
+        }
+    }
+    report(name, now()-start, points);
+    deleteGPXdoc(doc);
+}
+
+#define BATCH_SIZE 4
+
+//parses BATCH_SIZE copies of the file as one batch
+static void benchBatch(char* name, int numThreads, char* fileName){
+    char* fileNames[BATCH_SIZE];
+    for (int i=0; i<BATCH_SIZE; i++){
+        fileNames[i]=fileName;
+    }
+    GPXParseOptions options=makeOptions(true);
+    double start=now();
+    GPXBatchResult* results=createGPXdocBatch(fileNames, BATCH_SIZE, numThreads, &options);
+    if (results==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    long points=0;
+    for (int i=0; i<BATCH_SIZE; i++){
+        if (results[i].doc!=NULL){
+            points+=countPoints(results[i].doc);
+        }
+    }
+    deleteGPXBatch(results, BATCH_SIZE);
+    report(name, now()-start, points);
+}
+
+static void benchToString(char* name, const GPXParseOptions* options, char* fileName){
+    GPXdoc* doc=createGPXdocWithOptions(fileName, options);
+    if (doc==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    double start=now();
+    char* text=GPXdocToString(doc);
+    report(name, now()-start, countPoints(doc));
+    printf("%-28s %10zu bytes\n", "", (text!=NULL) ? strlen(text) : 0);
+    free(text);
+    deleteGPXdoc(doc);
+}
+
+//The approach writeGPXdoc replaces: build the whole XML tree, then save it
+static void addTreePoints(xmlNode* parent, char* element, List* waypoints){
+    ListIterator iter=createIterator(waypoints);
+    Waypoint* w;
+    while ((w=nextElement(&iter))!=NULL){
+        char number[32];
+        xmlNode* point=xmlNewChild(parent, NULL, BAD_CAST element, NULL);
+        snprintf(number, sizeof(number), "%.15g", w->latitude);
+        xmlNewProp(point, BAD_CAST "lat", BAD_CAST number);
+        snprintf(number, sizeof(number), "%.15g", w->longitude);
+        xmlNewProp(point, BAD_CAST "lon", BAD_CAST number);
+        if (w->name[0]!='\0'){
+            xmlNewTextChild(point, NULL, BAD_CAST "name", BAD_CAST w->name);
+        }
+        ListIterator dataIter=createIterator(w->otherData);
+        GPXData* d;
+        while ((d=nextElement(&dataIter))!=NULL){
+            xmlNewTextChild(point, NULL, BAD_CAST d->name, BAD_CAST d->value);
+        }
+    }
+}
+
+static bool writeTree(GPXdoc* doc, char* fileName){
+    xmlDoc* tree=xmlNewDoc(BAD_CAST "1.0");
+    xmlNode* root=xmlNewNode(NULL, BAD_CAST "gpx");
+    xmlDocSetRootElement(tree, root);
+    xmlSetNs(root, xmlNewNs(root, BAD_CAST doc->namespace, NULL));
+    xmlNewProp(root, BAD_CAST "creator", BAD_CAST doc->creator);
+    addTreePoints(root, "wpt", doc->waypoints);
+    ListIterator routes=createIterator(doc->routes);
+    Route* r;
+    while ((r=nextElement(&routes))!=NULL){
+        addTreePoints(xmlNewChild(root, NULL, BAD_CAST "rte", NULL), "rtept", r->waypoints);
+    }
+    ListIterator tracks=createIterator(doc->tracks);
+    Track* t;
+    while ((t=nextElement(&tracks))!=NULL){
+        xmlNode* track=xmlNewChild(root, NULL, BAD_CAST "trk", NULL);
+        ListIterator segments=createIterator(t->segments);
+        TrackSegment* s;
+        while ((s=nextElement(&segments))!=NULL){
+            addTreePoints(xmlNewChild(track, NULL, BAD_CAST "trkseg", NULL), "trkpt", s->waypoints);
+        }
+    }
+    bool saved=xmlSaveFormatFileEnc(fileName, tree, "UTF-8", 1)>=0;
+    xmlFreeDoc(tree);
+    return saved;
+}
+
+static bool writeStream(GPXdoc* doc, char* fileName){
+    return writeGPXdoc(doc, fileName);
+}
+
+static void benchWriter(char* name, bool (*write)(GPXdoc*, char*), char* fileName){
+    GPXParseOptions options=makeOptions(true);
+    GPXdoc* doc=createGPXdocWithOptions(fileName, &options);
+    char path[]="/tmp/gpxbenchXXXXXX";
+    int fd=mkstemp(path);
+    if (doc==NULL || fd<0){
+        printf("%-28s failed\n", name);
+        deleteGPXdoc(doc);
+        return;
+    }
+    close(fd);
+    double start=now();
+    bool written=write(doc, path);
+    report(written ? name : "write failed", now()-start, countPoints(doc));
+    deleteGPXdoc(doc);
+    remove(path);
+}
+
+static bool countPoint(const WaypointView* point, void* userData){
+    (*(long*)userData)++;
+    return true;
+}
+
+static void benchVisitor(char* fileName){
+    long points=0;
+    GPXVisitor visitor;
+    memset(&visitor, 0, sizeof(GPXVisitor));
+    visitor.userData=&points;
+    visitor.onWaypoint=&countPoint;
+    double start=now();
+    if (visitGPXFile(fileName, &visitor)==false){
+        printf("%-28s failed\n", "visitGPXFile");
+        return;
+    }
+    report("visitGPXFile", now()-start, points);
+}
+
+#define NUM_QUERIES 1000
+
+typedef struct {
+    double* latitudes;
+    double* longitudes;
+    int count;
+} QueryCentres;
+
+//keeps the first NUM_QUERIES points of a world-wide query as query centres
+static bool keepCentre(const GPXSpatialHit* hit, void* userData){
+    QueryCentres* centres=userData;
+    centres->latitudes[centres->count]=hit->latitude;
+    centres->longitudes[centres->count]=hit->longitude;
+    centres->count++;
+    return centres->count<NUM_QUERIES;
+}
+
+static void benchSpatial(char* fileName){
+    GPXParseOptions options=makeOptions(true);
+    options.columnarSegments=true;
+    GPXdoc* doc=createGPXdocWithOptions(fileName, &options);
+    if (doc==NULL){
+        printf("%-28s failed\n", "spatial index");
+        return;
+    }
+    double start=now();
+    GPXSpatialIndex* index=buildSpatialIndex(doc);
+    report("spatial index, build", now()-start, getSpatialIndexSize(index));
+
+    double latitudes[NUM_QUERIES];
+    double longitudes[NUM_QUERIES];
+    QueryCentres centres={latitudes, longitudes, 0};
+    querySpatialBox(index, -90.0, -180.0, 90.0, 180.0, &keepCentre, &centres);
+    if (centres.count>0){
+        long found=0;
+        start=now();
+        for (int i=0; i<NUM_QUERIES; i++){
+            found+=querySpatialRadius(index, latitudes[i%centres.count], longitudes[i%centres.count], 50.0, NULL, NULL);
+        }
+        double seconds=now()-start;
+        printf("%-28s %10.3f s %12d queries %12.0f queries/s %ld points found\n", "spatial index, 50 m query",
+               seconds, NUM_QUERIES, NUM_QUERIES/seconds, found);
+    }
+    deleteSpatialIndex(index);
+    deleteGPXdoc(doc);
+}
+
+//sums the length of every track segment of a mapped binary file, reading the coordinates in place
+static double binaryLength(const GPXBinary* binary){
+    double total=0.0;
+    for (int t=0; t<getBinaryNumTracks(binary); t++){
+        for (int s=0; s<getBinaryNumSegments(binary, t); s++){
+            GPXBinaryPoints points=getBinarySegmentPoints(binary, t, s);
+            total+=getPathLength(points.latitude, points.longitude, points.length);
+        }
+    }
+    return total;
+}
+
+static void benchBinary(char* fileName){
+    GPXParseOptions options=makeOptions(true);
+    options.columnarSegments=true;
+    GPXdoc* doc=createGPXdocWithOptions(fileName, &options);
+    char path[]="/tmp/gpxbenchXXXXXX";
+    int fd=mkstemp(path);
+    if (doc==NULL || fd<0){
+        printf("%-28s failed\n", "binary cache");
+        deleteGPXdoc(doc);
+        return;
+    }
+    close(fd);
+    long points=countPoints(doc);
+    double start=now();
+    bool saved=saveGPXBinary(doc, path);
+    report("saveGPXBinary", now()-start, points);
+    deleteGPXdoc(doc);
+
+    start=now();
+    GPXBinary* binary=saved ? mapGPXBinary(path) : NULL;
+    report("mapGPXBinary", now()-start, points);
+    if (binary!=NULL){
+        start=now();
+        double length=binaryLength(binary);
+        report("binary, track length", now()-start, points);
+        printf("%-28s %10.0f m\n", "", length);
+        start=now();
+        bool verified=verifyGPXBinary(binary);
+        report(verified ? "verifyGPXBinary" : "verifyGPXBinary failed", now()-start, points);
+        start=now();
+        doc=gpxBinaryToGPXdoc(binary);
+        report("gpxBinaryToGPXdoc", now()-start, points);
+        deleteGPXdoc(doc);
+        unmapGPXBinary(binary);
+    }
+    remove(path);
+}
+
+#define NUM_COORDINATES 1000000
+#define COORDINATE_SIZE 16
+
+static double parseAtof(const char* text){
+    return atof(text);
+}
+
+static double parseStrtod(const char* text){
+    return strtod(text, NULL);
+}
+
+static double parseDecimal(const char* text){
+    double value=0.0;
+    parseGPXDecimal(text, &value);
+    return value;
+}
+
+//parses the same latitudes, written as lat attributes are, with each parser
+static void benchCoordinates(void){
+    char* texts=malloc((size_t)NUM_COORDINATES*COORDINATE_SIZE);
+    if (texts==NULL){
+        printf("%-28s failed\n", "coordinates");
+        return;
+    }
+    for (int i=0; i<NUM_COORDINATES; i++){
+        snprintf(texts+(size_t)i*COORDINATE_SIZE, COORDINATE_SIZE, "%.7f", -90.0+180.0*i/NUM_COORDINATES);
+    }
+    char* names[]={"coordinates, atof", "coordinates, strtod", "coordinates, parseGPXDecimal"};
+    double (*parsers[])(const char*)={&parseAtof, &parseStrtod, &parseDecimal};
+    for (int p=0; p<3; p++){
+        double start=now();
+        double sum=0.0;
+        for (int i=0; i<NUM_COORDINATES; i++){
+            sum+=parsers[p](texts+(size_t)i*COORDINATE_SIZE);
+        }
+        report(names[p], now()-start, NUM_COORDINATES);
+        //keeps the loop from being optimised away
+        if (sum==1.0){
+            printf("\n");
+        }
+    }
+    free(texts);
+}
+
+#define NUM_VALIDATIONS 10
+
+//validates the file against a schema compiled for that one file, as every call did before schemas were cached
+static bool validateUncached(char* fileName, char* schemaFile){
+    xmlSchemaParserCtxtPtr parser=xmlSchemaNewParserCtxt(schemaFile);
+    xmlSchemaPtr schema=(parser!=NULL) ? xmlSchemaParse(parser) : NULL;
+    xmlSchemaValidCtxtPtr context=(schema!=NULL) ? xmlSchemaNewValidCtxt(schema) : NULL;
+    bool valid=(context!=NULL && xmlSchemaValidateFile(context, fileName, 0)==0);
+    xmlSchemaFreeValidCtxt(context);
+    xmlSchemaFree(schema);
+    xmlSchemaFreeParserCtxt(parser);
+    return valid;
+}
+
+static void benchValidate(char* fileName, char* schemaFile){
+    double start=now();
+    bool valid=true;
+    for (int i=0; i<NUM_VALIDATIONS; i++){
+        valid=valid && validateUncached(fileName, schemaFile);
+    }
+    double uncached=now()-start;
+    start=now();
+    for (int i=0; i<NUM_VALIDATIONS; i++){
+        valid=valid && validateGPXFile(fileName, schemaFile);
+    }
+    double cached=now()-start;
+    if (valid==false){
+        printf("%-28s failed\n", "validateGPXFile");
+        return;
+    }
+    printf("%-28s %10.3f s %12d files %12.0f files/s\n", "compile schema per file", uncached, NUM_VALIDATIONS, NUM_VALIDATIONS/uncached);
+    printf("%-28s %10.3f s %12d files %12.0f files/s\n", "validateGPXFile", cached, NUM_VALIDATIONS, NUM_VALIDATIONS/cached);
+}
+
+#define NUM_LIST_ELEMENTS 5000000
+
+static char* printNothing(void* data){
+    return NULL;
+}
+
+static void deleteNothing(void* data){
+}
+
+static int compareNothing(const void* first, const void* second){
+    return 0;
+}
+
+//insertBack, or one insertBackBatch, and a full iteration of a list of NUM_LIST_ELEMENTS, as the parser
+//builds and reads segments
+static void benchListStorage(char* name, ListStorage storage, bool batch){
+    static char element;
+    void** items=NULL;
+    if (batch){
+        items=malloc(NUM_LIST_ELEMENTS*sizeof(void*));
+        for (int i=0; items!=NULL && i<NUM_LIST_ELEMENTS; i++){
+            items[i]=&element;
+        }
+    }
+    double start=now();
+    List* list=initializeListWithStorage(&printNothing, &deleteNothing, &compareNothing, storage, NULL);
+    if (list==NULL || (batch && (items==NULL || insertBackBatch(list, items, NUM_LIST_ELEMENTS)==false))){
+        printf("%-28s failed\n", name);
+        if (list!=NULL){
+            freeList(list);
+        }
+        free(items);
+        return;
+    }
+    for (int i=0; batch==false && i<NUM_LIST_ELEMENTS; i++){
+        insertBack(list, &element);
+    }
+    long count=0;
+    ListIterator iter=createIterator(list);
+    while (nextElement(&iter)!=NULL){
+        count++;
+    }
+    freeList(list);
+    report(name, now()-start, count);
+    free(items);
+}
+
+#define NUM_ITERATIONS 20
+
+//NUM_ITERATIONS full iterations of a list of NUM_LIST_ELEMENTS built with insertBack, with nextElement or,
+//a chunk at a time, with nextElements
+static void benchListIteration(char* name, ListStorage storage, bool chunks){
+    static char elements[64];
+    List* list=initializeListWithStorage(&printNothing, &deleteNothing, &compareNothing, storage, NULL);
+    if (list==NULL){
+        printf("%-28s failed\n", name);
+        return;
+    }
+    for (int i=0; i<NUM_LIST_ELEMENTS; i++){
+        insertBack(list, &elements[i%64]);
+    }
+    double start=now();
+    long count=0;
+    for (int i=0; i<NUM_ITERATIONS; i++){
+        ListIterator iter=createIterator(list);
+        if (chunks){
+            void** items;
+            int length;
+            while ((length=nextElements(&iter, &items))>0){
+                for (int j=0; j<length; j++){
+                    count+=(items[j]!=NULL);
+                }
+            }
+        }
+        else{
+            void* item;
+            while ((item=nextElement(&iter))!=NULL){
+                count++;
+            }
+        }
+    }
+    report(name, now()-start, count);
+    freeList(list);
+}
+
+#define NUM_SORTED_ELEMENTS 10000
+
+static int compareKeys(const void* first, const void* second){
+    int a=*(const int*)first;
+    int b=*(const int*)second;
+    return (a>b)-(a<b);
+}
+
+//insertSorted of NUM_SORTED_ELEMENTS keys in random order, then a lookup of each
+static void benchSortedList(char* name, ListStorage storage){
+    int* keys=malloc(NUM_SORTED_ELEMENTS*sizeof(int));
+    List* list=initializeListWithStorage(&printNothing, &deleteNothing, &compareKeys, storage, NULL);
+    if (keys==NULL || list==NULL){
+        printf("%-28s failed\n", name);
+        free(keys);
+        if (list!=NULL){
+            freeList(list);
+        }
+        return;
+    }
+    unsigned int seed=1;
+    for (int i=0; i<NUM_SORTED_ELEMENTS; i++){
+        seed=seed*1103515245+12345;
+        keys[i]=(int)(seed>>8);
+    }
+    double start=now();
+    for (int i=0; i<NUM_SORTED_ELEMENTS; i++){
+        insertSorted(list, &keys[i]);
+    }
+    long found=0;
+    for (int i=0; i<NUM_SORTED_ELEMENTS; i++){
+        found+=(findSortedElement(list, &keys[i])!=NULL);
+    }
+    double elapsed=now()-start;
+    freeList(list);
+    report(name, elapsed, found);
+    free(keys);
+}
+
+//Removes every other one of NUM_SORTED_ELEMENTS keys, through deleteDataFromList or through their nodes
+static void benchRemove(char* name, bool byNode){
+    int* keys=malloc(NUM_SORTED_ELEMENTS*sizeof(int));
+    Node** nodes=malloc(NUM_SORTED_ELEMENTS*sizeof(Node*));
+    List* list=initializeList(&printNothing, &deleteNothing, &compareKeys);
+    if (keys==NULL || nodes==NULL || list==NULL){
+        printf("%-28s failed\n", name);
+        free(keys);
+        free(nodes);
+        if (list!=NULL){
+            freeList(list);
+        }
+        return;
+    }
+    for (int i=0; i<NUM_SORTED_ELEMENTS; i++){
+        keys[i]=i;
+        nodes[i]=insertBackNode(list, &keys[i]);
+    }
+    double start=now();
+    long removed=0;
+    for (int i=NUM_SORTED_ELEMENTS-1; i>=0; i-=2){
+        void* data=byNode ? removeNode(list, nodes[i]) : deleteDataFromList(list, &keys[i]);
+        removed+=(data!=NULL);
+    }
+    double elapsed=now()-start;
+    freeList(list);
+    report(name, elapsed, removed);
+    free(keys);
+    free(nodes);
+}
+
+//sortList of NUM_LIST_ELEMENTS keys in random order
+static void benchSortList(char* name, ListStorage storage){
+    int* keys=malloc(NUM_LIST_ELEMENTS*sizeof(int));
+    List* list=initializeListWithStorage(&printNothing, &deleteNothing, &compareKeys, storage, NULL);
+    if (keys==NULL || list==NULL){
+        printf("%-28s failed\n", name);
+        free(keys);
+        if (list!=NULL){
+            freeList(list);
+        }
+        return;
+    }
+    unsigned int seed=1;
+    for (int i=0; i<NUM_LIST_ELEMENTS; i++){
+        seed=seed*1103515245+12345;
+        keys[i]=(int)(seed>>8);
+        insertBack(list, &keys[i]);
+    }
+    double start=now();
+    bool sorted=sortList(list, NULL);
+    double elapsed=now()-start;
+    if (sorted){
+        report(name, elapsed, getLength(list));
+    }
+    else{
+        printf("%-28s failed\n", name);
+    }
+    freeList(list);
+    free(keys);
+}
+
+int main(int argc, char* argv[]){
+    if (argc<2){
+        printf("usage: %s file.gpx [gpx.xsd]\n", argv[0]);
+        return 1;
+    }
+    char* fileName=argv[1];
+    GPXParseOptions streaming=makeOptions(true);
+    GPXParseOptions parallel=makeOptions(false);
+    parallel.numThreads=-1;
+    GPXParseOptions arena=streaming;
+    arena.useArena=true;
+    GPXParseOptions columnar=streaming;
+    columnar.columnarSegments=true;
+    GPXParseOptions typed=streaming;
+    typed.typedPointData=true;
+    GPXParseOptions unrolled=streaming;
+    unrolled.unrolledLists=true;
+
+    benchDoc("createGPXdoc", NULL, fileName);
+    benchDoc("createGPXdoc, all processors", &parallel, fileName);
+    benchFd("createGPXdoc, from fd", fileName);
+    benchMemory("createGPXdocFromMemory", false, fileName);
+    benchDoc("createGPXdocStreaming", &streaming, fileName);
+    benchMemory("streaming from memory", true, fileName);
+    benchCompressed(fileName);
+    benchDoc("streaming + arena", &arena, fileName);
+    benchDoc("streaming + columnar", &columnar, fileName);
+    benchDoc("streaming + typed points", &typed, fileName);
+    benchDoc("streaming + unrolled lists", &unrolled, fileName);
+    benchBatch("batch of 4, 1 thread", 1, fileName);
+    benchBatch("batch of 4, all processors", 0, fileName);
+    benchVisitor(fileName);
+    benchLength("length, list segments", &streaming, fileName);
+    benchLength("length, columnar segments", &columnar, fileName);
+    benchSummary(fileName);
+    benchColumns("columns from GPXData text", &streaming, fileName);
+    benchColumns("columns from typed points", &typed, fileName);
+    benchToString("GPXdocToString", &streaming, fileName);
+    benchWriter("writeGPXdoc", &writeStream, fileName);
+    benchWriter("xmlDoc tree + xmlSaveFile", &writeTree, fileName);
+    benchSpatial(fileName);
+    benchBinary(fileName);
+    benchCoordinates();
+    benchListStorage("list, linked nodes", LIST_LINKED, false);
+    benchListStorage("list, linked batch", LIST_LINKED, true);
+    benchListStorage("list, unrolled chunks", LIST_UNROLLED, false);
+    benchListStorage("list, unrolled batch", LIST_UNROLLED, true);
+    benchListIteration("iterate, linked nodes", LIST_LINKED, false);
+    benchListIteration("iterate, unrolled", LIST_UNROLLED, false);
+    benchListIteration("iterate, unrolled chunks", LIST_UNROLLED, true);
+    benchSortedList("sorted list, linked", LIST_LINKED);
+    benchSortedList("sorted list, skip list", LIST_SORTED);
+    benchSortList("sortList, linked nodes", LIST_LINKED);
+    benchSortList("sortList, unrolled chunks", LIST_UNROLLED);
+    benchRemove("remove, deleteDataFromList", false);
+    benchRemove("remove, removeNode", true);
+    if (argc>2){
+        benchValidate(fileName, argv[2]);
+    }
+    return 0;
+}
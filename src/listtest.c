@@ -0,0 +1,582 @@
+/*
+ * Unit tests for the list API: every storage, with and without an allocator.
+ * Build and run with make test.  Prints each failed check, and exits with 1 if there was one.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "LinkedListAPI.h"
+
+#define MAX_ITEMS 400
+
+typedef struct item{
+	int key;
+	int id;
+} Item;
+
+static Item items[MAX_ITEMS];
+static int numFailed = 0;
+static int numDeleted = 0;
+
+//Counts the blocks it has handed out and not been given back, so a test can tell that a list released everything
+typedef struct countingAllocator{
+	ListAllocator allocator;
+	int live;
+} CountingAllocator;
+
+static void* countedAllocate(void* context, size_t size){
+	void* memory = calloc(1, size);
+	if (memory != NULL){
+		((CountingAllocator*)context)->live++;
+	}
+	return memory;
+}
+
+static void countedRelease(void* context, void* toBeReleased){
+	if (toBeReleased != NULL){
+		((CountingAllocator*)context)->live--;
+		free(toBeReleased);
+	}
+}
+
+static void initializeAllocator(CountingAllocator* counting){
+	counting->allocator.allocate = &countedAllocate;
+	counting->allocator.release = &countedRelease;
+	counting->allocator.context = counting;
+	counting->live = 0;
+}
+
+static char* printItem(void* toBePrinted){
+	char* text = malloc(32);
+	if (text != NULL){
+		Item* item = toBePrinted;
+		sprintf(text, "%d/%d", item->key, item->id);
+	}
+	return text;
+}
+
+//the items live in a static array, so deleting one only counts it
+static void deleteItem(void* toBeDeleted){
+	numDeleted++;
+}
+
+static int compareItems(const void* first, const void* second){
+	const Item* a = first;
+	const Item* b = second;
+	return (a->key > b->key) - (a->key < b->key);
+}
+
+static int compareIdsDescending(const void* first, const void* second){
+	const Item* a = first;
+	const Item* b = second;
+	return (a->id < b->id) - (a->id > b->id);
+}
+
+static void check(bool condition, const char* what, const char* test){
+	if (condition == false){
+		printf("FAIL: %s: %s\n", test, what);
+		numFailed++;
+	}
+}
+
+static const char* storageName(ListStorage storage){
+	if (storage == LIST_UNROLLED){
+		return "unrolled";
+	}else if (storage == LIST_SORTED){
+		return "sorted";
+	}
+	return "linked";
+}
+
+//fills the first count items with keys from 0 to range-1, so most keys appear more than once
+static void makeItems(int count, int range, unsigned int seed){
+	for (int i = 0; i < count; i++){
+		seed = seed * 1103515245 + 12345;
+		items[i].key = (int)((seed >> 8) % range);
+		items[i].id = i;
+	}
+}
+
+static List* makeList(ListStorage storage, CountingAllocator* counting){
+	return initializeListWithStorage(&printItem, &deleteItem, &compareItems, storage, (counting != NULL) ? &counting->allocator : NULL);
+}
+
+//Checks that list holds exactly the elements of model, in order, through the iterator, the ends and the nodes
+static void checkList(List* list, Item** model, int count, const char* test){
+	check(getLength(list) == count, "length", test);
+	ListIterator iter = createIterator(list);
+	int i = 0;
+	Item* item;
+	while ((item = nextElement(&iter)) != NULL){
+		if (i >= count || item != model[i]){
+			check(false, "order", test);
+			return;
+		}
+		i++;
+	}
+	check(i == count, "number of elements iterated", test);
+
+	iter = createIterator(list);
+	i = 0;
+	void** run;
+	int length;
+	while ((length = nextElements(&iter, &run)) > 0){
+		if (i + length > count || memcmp(run, &model[i], length * sizeof(void*)) != 0){
+			check(false, "order of nextElements", test);
+			return;
+		}
+		i += length;
+	}
+	check(i == count, "number of elements from nextElements", test);
+	check(getFromFront(list) == ((count > 0) ? model[0] : NULL), "front", test);
+	check(getFromBack(list) == ((count > 0) ? model[count - 1] : NULL), "back", test);
+	if (list->storage == LIST_UNROLLED){
+		check(list->head == NULL && list->tail == NULL, "unrolled list has no nodes", test);
+		return;
+	}
+	Node* previous = NULL;
+	for (Node* node = list->head; node != NULL; node = node->next){
+		if (node->previous != previous){
+			check(false, "previous links", test);
+			return;
+		}
+		previous = node;
+	}
+	check(list->tail == previous, "tail", test);
+}
+
+//Copies the elements of list into model, for a LIST_SORTED list whose order among equal keys was left to it
+static int readList(List* list, Item** model){
+	ListIterator iter = createIterator(list);
+	int count = 0;
+	Item* item;
+	while ((item = nextElement(&iter)) != NULL){
+		model[count++] = item;
+	}
+	return count;
+}
+
+static bool isSorted(Item** model, int count){
+	for (int i = 1; i < count; i++){
+		if (model[i - 1]->key > model[i]->key){
+			return false;
+		}
+	}
+	return true;
+}
+
+//the model of a stable sort
+static void sortModel(Item** model, int count, int (*compare)(const void* first, const void* second)){
+	for (int i = 1; i < count; i++){
+		Item* item = model[i];
+		int j = i;
+		while (j > 0 && compare(model[j - 1], item) > 0){
+			model[j] = model[j - 1];
+			j--;
+		}
+		model[j] = item;
+	}
+}
+
+static void removeFromModel(Item** model, int* count, int index){
+	memmove(&model[index], &model[index + 1], (*count - index - 1) * sizeof(Item*));
+	(*count)--;
+}
+
+//the model of insertSorted: before the first element the new one is not greater than
+static void insertIntoModel(Item** model, int* count, Item* item){
+	int i = 0;
+	while (i < *count && compareItems(item, model[i]) > 0){
+		i++;
+	}
+	memmove(&model[i + 1], &model[i], (*count - i) * sizeof(Item*));
+	model[i] = item;
+	(*count)++;
+}
+
+static int findInModel(Item** model, int count, int key){
+	for (int i = 0; i < count; i++){
+		if (model[i]->key == key){
+			return i;
+		}
+	}
+	return -1;
+}
+
+//insert, delete, find, iterate, sort and clear on one storage
+static void testBasics(ListStorage storage, CountingAllocator* counting){
+	char test[64];
+	sprintf(test, "basics, %s%s", storageName(storage), (counting != NULL) ? ", allocator" : "");
+	Item* model[MAX_ITEMS];
+	int count = 0;
+	numDeleted = 0;
+	makeItems(180, 50, 7);
+	List* list = makeList(storage, counting);
+	if (list == NULL){
+		check(false, "initializeListWithStorage", test);
+		return;
+	}
+
+	unsigned long version = getListVersion(list);
+	for (int i = 0; i < 60; i++){
+		insertBack(list, &items[i]);
+		model[count++] = &items[i];
+	}
+	check(getListVersion(list) != version, "version after insertBack", test);
+	for (int i = 60; i < 80; i++){
+		insertFront(list, &items[i]);
+		memmove(&model[1], &model[0], count * sizeof(Item*));
+		model[0] = &items[i];
+		count++;
+	}
+	void* batch[100];
+	for (int i = 0; i < 100; i++){
+		batch[i] = &items[80 + i];
+		model[count++] = &items[80 + i];
+	}
+	check(insertBackBatch(list, batch, 100), "insertBackBatch", test);
+	insertBack(list, NULL);
+
+	if (storage == LIST_SORTED){
+		check(readList(list, model) == count, "length", test);
+		check(isSorted(model, count), "sorted storage keeps the order", test);
+	}
+	checkList(list, model, count, test);
+
+	for (int key = 0; key < 60; key += 3){
+		int index = findInModel(model, count, key);
+		Item probe = {key, -1};
+		check(findSortedElement(list, &probe) == ((index >= 0) ? model[index] : NULL), "findSortedElement", test);
+		version = getListVersion(list);
+		Item* removed = deleteDataFromList(list, &probe);
+		check(removed == ((index >= 0) ? model[index] : NULL), "deleteDataFromList returns the first equal element", test);
+		if (index >= 0){
+			check(getListVersion(list) != version, "version after deleteDataFromList", test);
+			removeFromModel(model, &count, index);
+		}
+	}
+	check(numDeleted == 0, "deleteDataFromList does not delete the data", test);
+	checkList(list, model, count, test);
+
+	//removeFromList takes the given element even when an equal one comes before it
+	int numRemoved = 0;
+	for (int key = 1; key < 50; key += 3){
+		int index = findInModel(model, count, key);
+		int other = index + 1;
+		while (index >= 0 && other < count && model[other]->key != key){
+			other++;
+		}
+		if (index < 0 || other >= count){
+			continue;
+		}
+		Item* second = model[other];
+		version = getListVersion(list);
+		check(removeFromList(list, second), "removeFromList", test);
+		check(getListVersion(list) != version, "version after removeFromList", test);
+		check(removeFromList(list, second) == false, "removeFromList of an element that is gone", test);
+		removeFromModel(model, &count, other);
+		numRemoved++;
+	}
+	check(numRemoved > 0, "removeFromList had duplicates to remove", test);
+	check(numDeleted == 0, "removeFromList does not delete the data", test);
+	checkList(list, model, count, test);
+
+	bool sorted = sortList(list, &compareIdsDescending);
+	if (storage == LIST_SORTED){
+		check(sorted == false, "a sorted list cannot be sorted by another compare function", test);
+	}else{
+		check(sorted, "sortList", test);
+		sortModel(model, count, &compareIdsDescending);
+	}
+	checkList(list, model, count, test);
+	check(sortList(list, NULL), "sortList with the compare function of the list", test);
+	sortModel(model, count, &compareItems);
+	checkList(list, model, count, test);
+
+	char* text = toString(list);
+	check(text != NULL && strstr(text, "/") != NULL, "toString", test);
+	free(text);
+
+	int length = getLength(list);
+	clearList(list);
+	check(numDeleted == length, "clearList deletes every element", test);
+	checkList(list, model, 0, test);
+	insertBack(list, &items[0]);
+	model[0] = &items[0];
+	checkList(list, model, 1, test);
+	freeList(list);
+	check(numDeleted == length + 1, "freeList deletes every element", test);
+	if (counting != NULL){
+		check(counting->live == 0, "everything allocated is released", test);
+	}
+}
+
+//insertSorted with many equal keys, where every storage puts a new element before the ones equal to it
+static void testInsertSorted(ListStorage storage, CountingAllocator* counting){
+	char test[64];
+	sprintf(test, "insertSorted, %s%s", storageName(storage), (counting != NULL) ? ", allocator" : "");
+	Item* model[MAX_ITEMS];
+	int count = 0;
+	makeItems(300, 20, 11);
+	List* list = makeList(storage, counting);
+	for (int i = 0; i < 300; i++){
+		if (i % 2 == 0){
+			insertSorted(list, &items[i]);
+		}else{
+			Node* node = insertSortedNode(list, &items[i]);
+			if (storage == LIST_UNROLLED){
+				check(node == NULL, "insertSortedNode does nothing to an unrolled list", test);
+				continue;
+			}
+			check(node != NULL && node->data == &items[i], "insertSortedNode returns the node", test);
+		}
+		insertIntoModel(model, &count, &items[i]);
+	}
+	checkList(list, model, count, test);
+	freeList(list);
+	if (counting != NULL){
+		check(counting->live == 0, "everything allocated is released", test);
+	}
+}
+
+//fills a list with count items starting at first, one at a time or in one batch
+static void fillList(List* list, int first, int count, bool batch){
+	if (batch){
+		void* batchItems[MAX_ITEMS];
+		for (int i = 0; i < count; i++){
+			batchItems[i] = &items[first + i];
+		}
+		insertBackBatch(list, batchItems, count);
+	}else{
+		for (int i = first; i < first + count; i++){
+			insertBack(list, &items[i]);
+		}
+	}
+}
+
+//spliceList and appendList from a list of one storage and allocator to a list of another
+static void testSplice(ListStorage dstStorage, ListStorage srcStorage, CountingAllocator* dstCounting, CountingAllocator* srcCounting, bool batch){
+	char test[128];
+	sprintf(test, "splice, %s%s from %s%s%s", storageName(dstStorage), (dstCounting != NULL) ? " with allocator" : "",
+	        storageName(srcStorage), (srcCounting != NULL) ? " with allocator" : "", batch ? ", batch" : "");
+	Item* model[MAX_ITEMS];
+	Item* srcModel[MAX_ITEMS];
+	numDeleted = 0;
+	makeItems(160, 30, 3);
+
+	for (int append = 0; append < 2; append++){
+		List* dst = makeList(dstStorage, dstCounting);
+		List* src = makeList(srcStorage, srcCounting);
+		fillList(dst, 0, 70, batch);
+		fillList(src, 70, 90, batch);
+		int count = readList(dst, model);
+		int srcCount = readList(src, srcModel);
+
+		bool alike = (dstStorage == srcStorage && dstCounting == srcCounting && dstStorage != LIST_SORTED);
+		bool moved = append ? appendList(dst, src) : spliceList(dst, src);
+		check(moved == (append || alike), append ? "appendList" : "spliceList", test);
+		check(spliceList(dst, dst) == false && appendList(dst, dst) == false, "a list cannot be moved into itself", test);
+		if (moved){
+			for (int i = 0; i < srcCount; i++){
+				if (dstStorage == LIST_SORTED){
+					insertIntoModel(model, &count, srcModel[i]);
+				}else{
+					model[count++] = srcModel[i];
+				}
+			}
+			srcCount = 0;
+		}
+		checkList(dst, model, count, test);
+		checkList(src, srcModel, srcCount, test);
+
+		//both lists stay usable, including the nodes and blocks that moved
+		insertBack(src, &items[0]);
+		if (srcStorage == LIST_SORTED){
+			insertIntoModel(srcModel, &srcCount, &items[0]);
+		}else{
+			srcModel[srcCount++] = &items[0];
+		}
+		checkList(src, srcModel, srcCount, test);
+		if (dstStorage != LIST_SORTED){
+			insertBack(dst, &items[1]);
+			model[count++] = &items[1];
+			checkList(dst, model, count, test);
+		}
+		int total = getLength(dst) + getLength(src);
+		numDeleted = 0;
+		freeList(dst);
+		freeList(src);
+		check(numDeleted == total, "every element is deleted once", test);
+	}
+	if (dstCounting != NULL){
+		check(dstCounting->live == 0, "everything allocated is released", test);
+	}
+	if (srcCounting != NULL){
+		check(srcCounting->live == 0, "everything allocated is released", test);
+	}
+}
+
+//removeNode and insertAfter on the nodes of a batch block, and reuse of the removed nodes
+static void testRemoveBatchNodes(CountingAllocator* counting){
+	char test[64];
+	sprintf(test, "removeNode, batch block%s", (counting != NULL) ? ", allocator" : "");
+	Item* model[MAX_ITEMS];
+	int count = 0;
+	makeItems(300, 1000, 5);
+	List* list = makeList(LIST_LINKED, counting);
+	fillList(list, 0, 100, true);
+	for (int i = 0; i < 100; i++){
+		model[count++] = &items[i];
+	}
+
+	//the iterator stays valid when the node it returned is removed
+	ListIterator iter = createIterator(list);
+	Node* node;
+	int index = 0;
+	while ((node = nextNode(&iter)) != NULL){
+		if (index % 2 == 0){
+			check(removeNode(list, node) == &items[index], "removeNode returns the data", test);
+		}
+		index++;
+	}
+	count = 0;
+	for (int i = 1; i < 100; i += 2){
+		model[count++] = &items[i];
+	}
+	checkList(list, model, count, test);
+
+	//later inserts take the removed nodes
+	Node* handles[40];
+	for (int i = 0; i < 40; i++){
+		handles[i] = insertBackNode(list, &items[100 + i]);
+		model[count++] = &items[100 + i];
+	}
+	checkList(list, model, count, test);
+	for (int i = 0; i < 40; i += 4){
+		removeNode(list, handles[i]);
+	}
+	count = 50;
+	for (int i = 0; i < 40; i++){
+		if (i % 4 != 0){
+			model[count++] = &items[100 + i];
+		}
+	}
+	checkList(list, model, count, test);
+
+	Node* after = insertAfter(list, handles[1], &items[200]);
+	check(after != NULL && after->data == &items[200], "insertAfter", test);
+	int position = 51;
+	memmove(&model[position + 1], &model[position], (count - position) * sizeof(Item*));
+	model[position] = &items[200];
+	count++;
+	insertAfter(list, NULL, &items[201]);
+	memmove(&model[1], &model[0], count * sizeof(Item*));
+	model[0] = &items[201];
+	count++;
+	checkList(list, model, count, test);
+
+	fillList(list, 202, 60, true);
+	for (int i = 202; i < 262; i++){
+		model[count++] = &items[i];
+	}
+	checkList(list, model, count, test);
+	numDeleted = 0;
+	freeList(list);
+	check(numDeleted == count, "every element is deleted once", test);
+	if (counting != NULL){
+		check(counting->live == 0, "everything allocated is released", test);
+	}
+}
+
+//removeNode on the nodes of a skip list, in an order unrelated to the order of the list
+static void testRemoveSkipNodes(CountingAllocator* counting){
+	char test[64];
+	sprintf(test, "removeNode, skip list%s", (counting != NULL) ? ", allocator" : "");
+	Item* model[MAX_ITEMS];
+	Node* handles[MAX_ITEMS];
+	makeItems(300, 40, 13);
+	List* list = makeList(LIST_SORTED, counting);
+	for (int i = 0; i < 300; i++){
+		handles[i] = insertSortedNode(list, &items[i]);
+	}
+	int count = readList(list, model);
+	check(count == 300 && isSorted(model, count), "insertSortedNode keeps the order", test);
+	check(insertAfter(list, handles[0], &items[0]) == NULL, "insertAfter does nothing to a sorted list", test);
+
+	for (int step = 0; step < 150; step++){
+		int i = (step * 37) % 300;
+		check(removeNode(list, handles[i]) == &items[i], "removeNode returns the data", test);
+		for (int j = 0; j < count; j++){
+			if (model[j] == &items[i]){
+				removeFromModel(model, &count, j);
+				break;
+			}
+		}
+	}
+	checkList(list, model, count, test);
+	for (int key = 0; key < 40; key++){
+		Item probe = {key, -1};
+		int index = findInModel(model, count, key);
+		check(findSortedElement(list, &probe) == ((index >= 0) ? model[index] : NULL), "findSortedElement after removeNode", test);
+	}
+	for (int i = 0; i < 20; i++){
+		insertSorted(list, &items[i]);
+		insertIntoModel(model, &count, &items[i]);
+	}
+	checkList(list, model, count, test);
+	freeList(list);
+	if (counting != NULL){
+		check(counting->live == 0, "everything allocated is released", test);
+	}
+}
+
+//node handles do not exist in an unrolled list
+static void testUnrolledNodes(void){
+	const char* test = "node handles, unrolled";
+	makeItems(10, 10, 1);
+	List* list = makeList(LIST_UNROLLED, NULL);
+	check(insertBackNode(list, &items[0]) == NULL && insertFrontNode(list, &items[1]) == NULL, "insert returns NULL", test);
+	check(insertAfter(list, NULL, &items[2]) == NULL, "insertAfter returns NULL", test);
+	check(getLength(list) == 0, "nothing is inserted", test);
+	insertBack(list, &items[3]);
+	ListIterator iter = createIterator(list);
+	check(nextNode(&iter) == NULL, "nextNode returns NULL", test);
+	freeList(list);
+}
+
+int main(int argc, char* argv[]){
+	ListStorage storages[] = {LIST_LINKED, LIST_UNROLLED, LIST_SORTED};
+	CountingAllocator first;
+	CountingAllocator second;
+	initializeAllocator(&first);
+	initializeAllocator(&second);
+	CountingAllocator* allocators[] = {NULL, &first, &second};
+
+	for (int s = 0; s < 3; s++){
+		testBasics(storages[s], NULL);
+		testBasics(storages[s], &first);
+		testInsertSorted(storages[s], NULL);
+		testInsertSorted(storages[s], &first);
+	}
+	for (int d = 0; d < 3; d++){
+		for (int s = 0; s < 3; s++){
+			for (int da = 0; da < 3; da++){
+				for (int sa = 0; sa < 3; sa++){
+					testSplice(storages[d], storages[s], allocators[da], allocators[sa], false);
+					testSplice(storages[d], storages[s], allocators[da], allocators[sa], true);
+				}
+			}
+		}
+	}
+	testRemoveBatchNodes(NULL);
+	testRemoveBatchNodes(&first);
+	testRemoveSkipNodes(NULL);
+	testRemoveSkipNodes(&first);
+	testUnrolledNodes();
+
+	if (numFailed > 0){
+		printf("%d checks failed\n", numFailed);
+		return 1;
+	}
+	printf("all list tests passed\n");
+	return 0;
+}